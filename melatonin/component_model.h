@@ -2,18 +2,34 @@
 
 #include <utility>
 #include "helpers/component_helpers.h"
+#include "helpers/inspector_cost.h"
+#include "helpers/misc.h"
+#include "helpers/timing.h"
 #include "juce_gui_basics/juce_gui_basics.h"
 
 namespace melatonin
 {
-    class ComponentModel : private juce::Value::Listener, private juce::ComponentListener
+    class ComponentModel : private juce::Value::Listener, private juce::ComponentListener, private juce::Timer
     {
     public:
+        // what changed since the last notification, so listeners only redo what they display
+        enum Change
+        {
+            selectionChanged = 1 << 0, // a different component (or none) was selected
+            positionChanged = 1 << 1,
+            sizeChanged = 1 << 2,
+            propertiesChanged = 1 << 3, // flags, named properties, colors, accessibility
+            timingChanged = 1 << 4,
+            everythingChanged = selectionChanged | positionChanged | sizeChanged | propertiesChanged | timingChanged
+        };
+
         class Listener
         {
         public:
             virtual ~Listener() = default;
-            virtual void componentModelChanged (ComponentModel& model) = 0;
+
+            // changes is a mask of ComponentModel::Change flags
+            virtual void componentModelChanged (ComponentModel& model, int changes) = 0;
         };
 
         juce::Value nameValue;
@@ -23,6 +39,7 @@ namespace melatonin
         juce::Value lookAndFeelValue, typeValue, fontValue, alphaValue;
         juce::Value pickedColor;
         juce::Value timing1, timing2, timing3, timingMax, hasChildren;
+        juce::Value timingP50, timingP95, timingP99;
 
         juce::Value isToggleable, toggleState, clickTogglesState, radioGroupId;
 
@@ -31,7 +48,10 @@ namespace melatonin
             juce::Value title, value, role, handlerType;
         } accessiblityDetail;
 
-        double timingWithChildren1, timingWithChildren2, timingWithChildren3, timingWithChildrenMax;
+        double timingWithChildrenP50 = 0, timingWithChildrenP95 = 0, timingWithChildrenP99 = 0, timingWithChildrenMax = 0;
+
+        // the selected component's paint history, nullptr if it isn't timed
+        ComponentTiming::Ptr timing;
 
         ComponentModel() = default;
 
@@ -53,7 +73,8 @@ namespace melatonin
             if (selectedComponent)
                 selectedComponent->addComponentListener (this);
 
-            updateModel();
+            stopFrameUpdates();
+            updateModel (everythingChanged);
         }
 
         void deselectComponent()
@@ -64,7 +85,8 @@ namespace melatonin
                 selectedComponent->removeComponentListener (this);
 
             selectedComponent = nullptr;
-            updateModel();
+            stopFrameUpdates();
+            updateModel (everythingChanged);
         }
 
         struct NamedProperty
@@ -82,9 +104,9 @@ namespace melatonin
         std::vector<NamedProperty> namedProperties;
         std::vector<NamedProperty> colors;
 
-        void refresh()
+        void refresh (int changes = everythingChanged)
         {
-            updateModel();
+            updateModel (changes);
         }
 
         void removeListener (Listener& listener)
@@ -108,13 +130,33 @@ namespace melatonin
             return timing1.getValue().isDouble();
         }
 
+        // clears the selected component's paint history
+        void resetPerformanceTiming()
+        {
+            if (timing != nullptr)
+                timing->reset();
+
+            populatePerformanceData();
+            notifyListeners (timingChanged);
+        }
+
     private:
         juce::ListenerList<Listener> listenerList;
         juce::Component::SafePointer<juce::Component> selectedComponent;
 
-        void updateModel()
+        // bounds changes are collected and pushed to listeners at most once per frame
+        int pendingChanges = 0;
+        juce::uint32 lastFlushTime = 0;
+        juce::uint64 shownPaintGeneration = 0; // the timings are current as of this many paints
+        static constexpr juce::uint32 overBudgetFlushIntervalMs = 100;
+#if MELATONIN_VBLANK
+        juce::VBlankAttachment frameUpdates;
+#endif
+
+        void updateModel (int changes)
         {
             TRACE_COMPONENT();
+            InspectorCost::Scope cost (InspectorCost::modelRefresh);
 
             removeListeners();
 
@@ -126,10 +168,11 @@ namespace melatonin
             {
                 // if not manually removed, it'll linger in the model...
                 removePerformanceData();
-                notifyListeners();
+                notifyListeners (changes);
                 return;
             }
 
+            updateBounds();
             nameValue = selectedComponent->getName();
             lookAndFeelValue = lnfString (selectedComponent);
             visibleValue = selectedComponent->isVisible();
@@ -238,7 +281,7 @@ namespace melatonin
             }
 
             hasChildren.setValue (selectedComponent->getNumChildComponents() > 0);
-            populatePerformanceData (selectedComponent->getProperties());
+            populatePerformanceData();
 
             {
                 auto& properties = selectedComponent->getProperties();
@@ -256,7 +299,15 @@ namespace melatonin
                 for (auto& nv : colors)
                     nv.value.addListener (this);
             }
-            notifyListeners();
+            notifyListeners (changes);
+        }
+
+        void updateBounds()
+        {
+            xValue = selectedComponent->getX();
+            yValue = selectedComponent->getY();
+            widthValue = selectedComponent->getWidth();
+            heightValue = selectedComponent->getHeight();
         }
 
         void removeListeners()
@@ -307,6 +358,10 @@ namespace melatonin
                     int leftVal = xValue.getValue();
                     int topVal = yValue.getValue();
 
+                    // these values also follow the component around, don't echo that back
+                    if (selectedComponent->getPosition() == juce::Point<int> (leftVal, topVal))
+                        return;
+
                     // in cases where components are animated or moved via AffineTransforms
                     // we can get a feedback loop, as the left/top values are no longer
                     // the actual position in the component
@@ -411,27 +466,109 @@ namespace melatonin
         {
             TRACE_COMPONENT();
 
-            if (wasResized || wasMoved)
+            // only the bounds need re-reading, everything else is untouched by a move or resize
+            int changes = 0;
+            if (wasMoved)
+                changes |= positionChanged;
+            if (wasResized)
+                changes |= sizeChanged;
+
+            if (changes == 0 || !selectedComponent)
+                return;
+
+            // animations can move us many times per frame, listeners only need the last one
+            pendingChanges |= changes;
+            startFrameUpdates();
+        }
+
+        void startFrameUpdates()
+        {
+#if MELATONIN_VBLANK
+            // synced to the display of the component being inspected
+            if (frameUpdates.isEmpty())
+                frameUpdates = { selectedComponent.getComponent(), [this] {
+                                    flushPendingChanges();
+
+                                    // destroying the attachment from its own callback isn't allowed, the timer detaches it
+                                    if (pendingChanges == 0 && !isTimerRunning())
+                                        startTimer (1);
+                                } };
+#else
+            if (!isTimerRunning())
+                startTimerHz (60);
+#endif
+        }
+
+        void stopFrameUpdates()
+        {
+            pendingChanges = 0;
+#if MELATONIN_VBLANK
+            frameUpdates = {};
+#endif
+            stopTimer();
+        }
+
+        void timerCallback() override
+        {
+#if MELATONIN_VBLANK
+            // nothing came in since the last frame, reattached by the next move
+            stopTimer();
+            if (pendingChanges == 0 || !selectedComponent)
+                frameUpdates = {};
+#else
+            flushPendingChanges();
+
+            // restarted by the next move
+            if (pendingChanges == 0 || !selectedComponent)
+                stopTimer();
+#endif
+        }
+
+        void flushPendingChanges()
+        {
+            if (pendingChanges == 0 || !selectedComponent)
+                return;
+
+            // over budget, live updates drop to a few per second
+            auto now = juce::Time::getMillisecondCounter();
+            if (now - lastFlushTime < overBudgetFlushIntervalMs && InspectorCost::getInstance().isOverBudget())
+                return;
+
+            InspectorCost::Scope cost (InspectorCost::modelRefresh);
+            lastFlushTime = now;
+            auto changes = std::exchange (pendingChanges, 0);
+            updateBounds();
+
+            // moving or resizing usually repaints, so keep the timings live too
+            if (timing != nullptr && timing->getPaintGeneration() != shownPaintGeneration)
             {
-                updateModel();
+                populatePerformanceData();
+                changes |= timingChanged;
             }
+
+            notifyListeners (changes);
         }
 
-        void populatePerformanceData (const juce::NamedValueSet& props)
+        void populatePerformanceData()
         {
-            if (props.contains ("timing1"))
+            timing = ComponentTiming::find (selectedComponent);
+
+            if (timing != nullptr)
             {
-                // assume they are all there
-                timing1 = props["timing1"];
-                timing2 = props["timing2"];
-                timing3 = props["timing3"];
-                timingMax = props["timingMax"];
-
-                timingWithChildren1 = timing1.getValue();
-                timingWithChildren2 = timing2.getValue();
-                timingWithChildren3 = timing3.getValue();
-                timingWithChildrenMax = timingMax.getValue();
-                getTimingWithChildren (selectedComponent);
+                shownPaintGeneration = timing->getPaintGeneration();
+                timing1 = timing->getSample (0);
+                timing2 = timing->getSample (1);
+                timing3 = timing->getSample (2);
+                timingMax = timing->getMax();
+                timingP50 = timing->getPercentile (50);
+                timingP95 = timing->getPercentile (95);
+                timingP99 = timing->getPercentile (99);
+
+                // aggregated as children paint, no need to walk the subtree
+                timingWithChildrenP50 = timing->getInclusivePercentile (50);
+                timingWithChildrenP95 = timing->getInclusivePercentile (95);
+                timingWithChildrenP99 = timing->getInclusivePercentile (99);
+                timingWithChildrenMax = timing->getInclusiveMax();
             }
             else
             {
@@ -439,38 +576,27 @@ namespace melatonin
             }
         }
 
-        void notifyListeners()
+        void notifyListeners (int changes)
         {
-            listenerList.call ([this] (Listener& listener) {
-                listener.componentModelChanged (*this);
+            listenerList.call ([this, changes] (Listener& listener) {
+                listener.componentModelChanged (*this, changes);
             });
         }
 
         void removePerformanceData()
         {
+            timing = nullptr;
             timing1 = juce::var();
             timing2 = juce::var();
             timing3 = juce::var();
             timingMax = juce::var();
-            timingWithChildren1 = juce::var();
-            timingWithChildren2 = juce::var();
-            timingWithChildren3 = juce::var();
-            timingWithChildrenMax = juce::var();
-        }
-
-        void getTimingWithChildren (juce::Component* component)
-        {
-            for (auto child : component->getChildren())
-            {
-                if (child->getProperties().contains ("timing1"))
-                {
-                    timingWithChildren1 += (double) child->getProperties()["timing1"];
-                    timingWithChildren2 += (double) child->getProperties()["timing2"];
-                    timingWithChildren3 += (double) child->getProperties()["timing3"];
-                    timingWithChildrenMax += (double) child->getProperties()["timingMax"];
-                    getTimingWithChildren (child);
-                }
-            }
+            timingP50 = juce::var();
+            timingP95 = juce::var();
+            timingP99 = juce::var();
+            timingWithChildrenP50 = 0;
+            timingWithChildrenP95 = 0;
+            timingWithChildrenP99 = 0;
+            timingWithChildrenMax = 0;
         }
     };
 }
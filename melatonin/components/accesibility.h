@@ -43,9 +43,10 @@ namespace melatonin
     protected:
         ComponentModel& model;
 
-        void componentModelChanged (ComponentModel&) override
+        void componentModelChanged (ComponentModel&, int changes) override
         {
-            updateProperties();
+            if (changes & (ComponentModel::selectionChanged | ComponentModel::propertiesChanged))
+                updateProperties();
         }
 
         void resized() override
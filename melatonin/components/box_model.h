@@ -438,9 +438,14 @@ namespace melatonin
             paddingRightLabel.setBounds (area4);
         }
 
-        void componentModelChanged (ComponentModel&) override
+        void componentModelChanged (ComponentModel&, int changes) override
         {
             updateLabels();
+
+            // moving or resizing leaves padding and positioner untouched
+            if (!(changes & (ComponentModel::selectionChanged | ComponentModel::propertiesChanged)))
+                return;
+
             updatePaddingLabelsIfNeeded();
             
             Component *comp = model.getSelectedComponent();
@@ -3,6 +3,8 @@
 #include "colour_property_component.h"
 #include "juce_gui_extra/juce_gui_extra.h"
 #include "melatonin_inspector/melatonin/components/overlay.h"
+#include "melatonin_inspector/melatonin/helpers/color_stats.h"
+#include "melatonin_inspector/melatonin/helpers/root_backbuffer.h"
 #include "preview.h"
 
 namespace melatonin
@@ -74,7 +76,7 @@ namespace melatonin
             };
 
             // update color properties with the correct display format
-            rgbaToggle.onClick = [this]() { componentModelChanged (model); };
+            rgbaToggle.onClick = [this]() { componentModelChanged (model, ComponentModel::propertiesChanged); };
         }
 
         ~ColorPicker() override
@@ -87,6 +89,11 @@ namespace melatonin
                 root->removeMouseListener (this);
         }
 
+        [[nodiscard]] int getRegionStatsHeight() const
+        {
+            return colorPickerButton.on ? 46 : 0;
+        }
+
         void paint (juce::Graphics& g) override
         {
             if (colorPickerButton.on)
@@ -100,6 +107,8 @@ namespace melatonin
                 g.setColour (colors::text);
                 g.setFont (InspectorLookAndFeel::getInspectorFont (14.5, juce::Font::FontStyleFlags::plain));
                 g.drawText (stringForColor (selectedColor), colorValueBounds.withTrimmedBottom (2), juce::Justification::centred);
+
+                drawRegionStats (g);
             }
 
             if (model.colors.empty())
@@ -122,6 +131,8 @@ namespace melatonin
             // overlaps with the panel + bit of padding
             colorValueBounds = area.removeFromTop (32).withTrimmedRight (36).withSizeKeepingCentre (rgbaToggle.rgba ? 100 : 90, 32);
 
+            statsBounds = colorPickerButton.on ? area.removeFromTop (getRegionStatsHeight()).withTrimmedTop (5) : juce::Rectangle<int>();
+
             area.removeFromTop (5);
             panelBounds = area;
             if (!model.colors.empty())
@@ -152,6 +163,31 @@ namespace melatonin
             updatePicker (rootPos);
         }
 
+        // shift + drag analyses a rectangle instead of the loupe
+        void mouseDrag (const juce::MouseEvent& event) override
+        {
+            if (root == nullptr || !draggingRegion)
+                return;
+
+            auto rootPos = event.getEventRelativeTo (root).getPosition();
+            updatePicker (rootPos);
+
+            auto region = juce::Rectangle<int> (regionStart, rootPos);
+            if (region.isEmpty())
+                return;
+
+            backbuffer.copyTo (regionSnapshot, region);
+            regionStats = regionAnalyser.analyse (regionSnapshot, regionSnapshot.getBounds());
+            showingRegion = true;
+            repaint (statsBounds);
+        }
+
+        void mouseUp (const juce::MouseEvent&) override
+        {
+            // the region's stats stay up until a shift + click clears them
+            draggingRegion = false;
+        }
+
         void mouseExit (const juce::MouseEvent& event) override
         {
             // always try to keep this cursor
@@ -169,11 +205,19 @@ namespace melatonin
                 return;
             }
 
+            if (colorPickerButton.on && event.mods.isShiftDown())
+            {
+                regionStart = event.getEventRelativeTo (root).getPosition();
+                draggingRegion = true;
+                showingRegion = false;
+                return;
+            }
+
             if (colorPickerButton.on && selectedColor != juce::Colours::transparentBlack)
             {
                 event.eventComponent->setMouseCursor (cursorToRestore);
                 model.pickedColor.setValue ((int) selectedColor.getARGB());
-                model.refresh(); // update Last Picked
+                model.refresh (ComponentModel::propertiesChanged); // update Last Picked
                 colorPickerButton.on = false;
                 colorPickerButton.onClick();
                 repaint(); // needed in case we have nothing selected
@@ -205,14 +249,19 @@ namespace melatonin
             root = newRoot;
             if (root == nullptr)
             {
+                backbuffer.detach();
                 selectedColor = juce::Colours::transparentBlack;
                 reset();
             }
+            else if (colorPickerButton.on)
+            {
+                backbuffer.attach (*root);
+            }
         }
 
         void reset()
         {
-            componentModelChanged (model);
+            componentModelChanged (model, ComponentModel::everythingChanged);
         }
 
         // close the picker if we are hidden
@@ -233,6 +282,7 @@ namespace melatonin
         InspectorImageButton colorPickerButton { "eyedropper", { 0, 6 }, true };
         juce::Rectangle<int> colorValueBounds;
         juce::Rectangle<int> panelBounds;
+        juce::Rectangle<int> statsBounds;
         RGBAToggle rgbaToggle;
 
         juce::MouseCursor cursorToRestore = juce::MouseCursor::NormalCursor;
@@ -241,10 +291,19 @@ namespace melatonin
         bool mouseDownShouldOnlyFocus = false;
 
         juce::Colour selectedColor { juce::Colours::transparentBlack };
-        std::unique_ptr<juce::Image> croppedSnapshot;
+        RootBackbuffer backbuffer;
+        juce::Image croppedSnapshot; // reused across mouse moves
         int snapshotRadiusWidth = 21; // defaults align with initial dimensions of preview
         int snapshotRadiusHeight = 3;
 
+        // the loupe is analysed on every move, a shift + dragged region replaces it until a shift + click
+        RegionColorAnalyser loupeAnalyser, regionAnalyser;
+        RegionColorStats loupeStats, regionStats;
+        juce::Image regionSnapshot;
+        juce::Point<int> regionStart;
+        bool draggingRegion = false;
+        bool showingRegion = false;
+
         juce::Component* root {};
 
         void togglePicker (bool on)
@@ -255,6 +314,7 @@ namespace melatonin
             {
                 // get notified by all mouse activity in the target app/plugin
                 root->addMouseListener (this, true);
+                backbuffer.attach (*root);
 
                 reset();
 
@@ -267,9 +327,12 @@ namespace melatonin
             {
                 if (root != nullptr)
                     root->removeMouseListener (this);
+                backbuffer.detach();
 
                 preview.switchToPreview();
                 selectedColor = juce::Colours::transparentBlack;
+                draggingRegion = showingRegion = false;
+                regionSnapshot = juce::Image();
             }
 
             // might need to resize the panel if we need to toggle paint timings
@@ -290,17 +353,18 @@ namespace melatonin
                 return;
 
             updateSnapshot (positionInRoot);
-            auto snapshotBounds = croppedSnapshot->getBounds();
-            selectedColor = croppedSnapshot->getPixelAt (snapshotBounds.getCentreX(), snapshotBounds.getCentreY());
+            auto snapshotBounds = croppedSnapshot.getBounds();
+            selectedColor = croppedSnapshot.getPixelAt (snapshotBounds.getCentreX(), snapshotBounds.getCentreY());
+            loupeStats = loupeAnalyser.analyse (croppedSnapshot, snapshotBounds);
 
             // our snapshotted image will be larger than the preview panel (due to the bleed)
-            preview.setZoomedImage (*croppedSnapshot);
+            preview.setZoomedImage (croppedSnapshot);
             repaint();
         }
 
         // we continually update a cropped snapshot when picking
-        // this avoids a big cumbersome whole-plugin snapshot (bad for perf)
-        // but still lets users navigate the UI (changing tabs, popups, etc)
+        // it's copied out of a backbuffer that only re-renders what the target UI repainted,
+        // so users can still navigate the UI (changing tabs, popups, etc)
         void updateSnapshot (juce::Point<int> positionInRoot)
         {
             TRACE_COMPONENT();
@@ -309,7 +373,7 @@ namespace melatonin
                 return;
 
             auto snappedBounds = juce::Rectangle<int> (positionInRoot.x - snapshotRadiusWidth, positionInRoot.y - snapshotRadiusHeight, snapshotRadiusWidth * 2 + 1, snapshotRadiusHeight * 2 + 1);
-            croppedSnapshot = std::make_unique<juce::Image> (root->createComponentSnapshot (snappedBounds, false));
+            backbuffer.copyTo (croppedSnapshot, snappedBounds);
         }
 
         void updateSnapshotDimensions()
@@ -340,10 +404,13 @@ namespace melatonin
             jassert (snapshotRadiusHeight == 3);
         }
 
-        void componentModelChanged (ComponentModel&) override
+        void componentModelChanged (ComponentModel&, int changes) override
         {
             TRACE_COMPONENT();
 
+            if (!(changes & (ComponentModel::selectionChanged | ComponentModel::propertiesChanged)))
+                return;
+
             panel.clear();
             juce::Array<juce::PropertyComponent*> props;
 
@@ -361,6 +428,68 @@ namespace melatonin
             resized();
         }
 
+        void drawRegionStats (juce::Graphics& g)
+        {
+            TRACE_COMPONENT();
+
+            if (statsBounds.isEmpty())
+                return;
+
+            auto& stats = showingRegion ? regionStats : loupeStats;
+            auto area = statsBounds;
+            g.setFont (InspectorLookAndFeel::getInspectorFont (12, juce::Font::FontStyleFlags::plain));
+
+            auto swatches = area.removeFromTop (20);
+            const std::pair<const char*, juce::Colour> summaries[] { { "avg", stats.mean }, { "med", stats.median }, { "dom", stats.dominant } };
+            for (auto& [name, colour] : summaries)
+            {
+                auto swatch = swatches.removeFromLeft (54);
+                g.setColour (colour);
+                g.fillRoundedRectangle (swatch.removeFromLeft (14).withSizeKeepingCentre (14, 14).toFloat(), 2);
+                g.setColour (colors::propertyName);
+                g.drawText (name, swatch.withTrimmedLeft (5), juce::Justification::centredLeft);
+            }
+            drawLumaHistogram (g, stats, swatches.removeFromLeft (96).reduced (0, 3));
+
+            g.setColour (colors::propertyValueDisabled);
+            auto regionLabel = showingRegion ? "region " : "loupe ";
+            g.drawText (regionLabel + juce::String (stats.numPixels) + "px", swatches, juce::Justification::centredRight);
+
+            // a sample of the foreground cluster drawn on the background cluster
+            auto contrast = area.withTrimmedTop (4);
+            auto sample = contrast.removeFromLeft (32);
+            g.setColour (stats.background);
+            g.fillRoundedRectangle (sample.toFloat(), 2);
+            g.setColour (stats.foreground);
+            g.drawText ("Aa", sample, juce::Justification::centred);
+
+            contrast.removeFromLeft (8);
+            auto ratio = stats.contrastRatio;
+            auto level = ratio >= 7.0f ? "AAA" : ratio >= 4.5f ? "AA" : ratio >= 3.0f ? "AA large" : "fails AA";
+            g.setColour (ratio >= 4.5f ? colors::propertyValue : ratio >= 3.0f ? colors::propertyValueWarn : colors::propertyValueError);
+            g.drawText (juce::String (ratio, 2) + ":1 " + level, contrast, juce::Justification::centredLeft);
+        }
+
+        static void drawLumaHistogram (juce::Graphics& g, const RegionColorStats& stats, juce::Rectangle<int> bounds)
+        {
+            // 256 bins squashed into one bar per pixel column
+            auto tallest = *std::max_element (stats.lumaHistogram.begin(), stats.lumaHistogram.end());
+            if (tallest == 0 || bounds.isEmpty())
+                return;
+
+            g.setColour (colors::propertyName);
+            auto binsPerBar = juce::jmax (1, 256 / bounds.getWidth());
+            for (int bin = 0, x = bounds.getX(); bin < 256 && x < bounds.getRight(); bin += binsPerBar, ++x)
+            {
+                juce::uint32 count = 0;
+                for (int i = bin; i < juce::jmin (256, bin + binsPerBar); ++i)
+                    count = juce::jmax (count, stats.lumaHistogram[(size_t) i]);
+
+                auto height = (float) bounds.getHeight() * (float) count / (float) tallest;
+                g.fillRect (juce::Rectangle<float> ((float) x, (float) bounds.getBottom() - height, 1.0f, height));
+            }
+        }
+
         juce::String stringForColor (juce::Colour& color) const
         {
             return rgbaToggle.rgba ? colors::rgbaString (color) : colors::hexString (color);
@@ -1,50 +1,98 @@
 #pragma once
+#include <map>
+#include <set>
+#include <unordered_set>
+#include <vector>
 
 namespace melatonin
 {
     class Overlay;
+    class ComponentTreeViewItem;
+
+    // Collects branches whose children changed and validates each one once
+    // per message loop turn, so a burst of child changes costs one update
+    class TreeUpdateScheduler : private juce::AsyncUpdater
+    {
+    public:
+        ~TreeUpdateScheduler() override
+        {
+            cancelPendingUpdate();
+        }
+
+        void markDirty (ComponentTreeViewItem* item)
+        {
+            dirty.insert (item);
+            triggerAsyncUpdate();
+        }
+
+        // items call this when they are deleted
+        void forget (ComponentTreeViewItem* item)
+        {
+            dirty.erase (item);
+        }
+
+        // apply pending updates right away, before something relies on the tree structure
+        void flush()
+        {
+            handleUpdateNowIfNeeded();
+        }
+
+    private:
+        std::set<ComponentTreeViewItem*> dirty;
+
+        void handleAsyncUpdate() override;
+    };
+
+    // which components the tree shows while searching
+    // items for anything else collapse to zero height, nothing is removed
+    struct TreeSearchFilter
+    {
+        bool active = false;
+        std::unordered_set<juce::Component*> visible; // matches and their ancestors
+
+        [[nodiscard]] bool shows (juce::Component* c) const { return !active || visible.count (c) > 0; }
+    };
 
     class ComponentTreeViewItem
         : public juce::TreeViewItem,
-          public juce::ComponentListener
+          public juce::ComponentListener,
+          private juce::Label::Listener
     {
     public:
         bool hasTabbedComponent = false;
 
         explicit ComponentTreeViewItem (juce::Component* c,
             std::function<void (juce::Component* c)> outline,
-            std::function<void (juce::Component* c)> select)
-            : outlineComponentCallback (outline), selectComponentCallback (select), component (c)
+            std::function<void (juce::Component* c)> select,
+            TreeUpdateScheduler* s = nullptr,
+            const TreeSearchFilter* f = nullptr)
+            : outlineComponentCallback (outline), selectComponentCallback (select), component (c), scheduler (s), filter (f)
         {
-            // A few JUCE component types need massaging to get their child components
-            if (auto multiPanel = dynamic_cast<juce::MultiDocumentPanel*> (c))
-            {
-                recursivelyAddChildrenFor (multiPanel->getCurrentTabbedComponent());
-            }
-            else if (auto tabs = dynamic_cast<juce::TabbedComponent*> (c))
-            {
-                hasTabbedComponent = true;
-                for (int i = 0; i < tabs->getNumTabs(); ++i)
-                {
-                    recursivelyAddChildrenFor (tabs->getTabContentComponent (i));
-                }
-            }
-            else
-            {
-                addItemsForChildComponents();
-            }
+            // children are only built once we're opened, see itemOpennessChanged
+            hasTabbedComponent = dynamic_cast<juce::TabbedComponent*> (c) != nullptr;
 
             setDrawsInLeftMargin (true);
 
             // Make our tree self-aware
             component->addComponentListener (this);
+
+            // label text is part of our display name
+            if (auto label = dynamic_cast<juce::Label*> (c))
+                label->addListener (this);
         }
 
         ~ComponentTreeViewItem() override
         {
+            if (scheduler)
+                scheduler->forget (this);
+
             // The component can be deleted before this tree view item
             if (component)
+            {
                 component->removeComponentListener (this);
+                if (auto label = dynamic_cast<juce::Label*> (component.getComponent()))
+                    label->removeListener (this);
+            }
         }
 
         static juce::Path getKeyboardIcon()
@@ -65,6 +113,21 @@ namespace melatonin
             return component != nullptr && (component->getNumChildComponents() > 0);
         }
 
+        void itemOpennessChanged (bool isNowOpen) override
+        {
+            if (isNowOpen)
+                ensureSubItemsAreBuilt();
+        }
+
+        void ensureSubItemsAreBuilt()
+        {
+            if (subItemsBuilt || component == nullptr)
+                return;
+
+            subItemsBuilt = true;
+            addItemsForChildComponents();
+        }
+
         // naive but functional...
         void openTreeAndSelect (juce::Component* target)
         {
@@ -79,6 +142,7 @@ namespace melatonin
             {
                 jassert (target);
                 setOpen (true);
+                ensureSubItemsAreBuilt();
                 // recursively open up tree to get at target
                 for (int i = 0; i < getNumSubItems(); ++i)
                 {
@@ -127,12 +191,17 @@ namespace melatonin
             if (!component->isVisible())
                 g.setColour (colors::treeItemTextDisabled);
 
-            auto name = componentString (component);
-            auto font = InspectorLookAndFeel::getInspectorFont (15, juce::Font::FontStyleFlags::plain);
-
-            g.setFont (font);
+            // shaping text is the expensive part of scrolling, so it's only redone when the name or width changes
+            auto textBounds = juce::Rectangle<int> (w - textIndent, itemArea.getHeight());
+            if (textBounds != cachedTextBounds)
+            {
+                cachedTextBounds = textBounds;
+                cachedGlyphs.clear();
+                cachedGlyphs.addCurtailedLineOfText (getRowFont(), getDisplayName(), 0.0f, 0.0f, (float) textBounds.getWidth(), true);
+                cachedGlyphs.justifyGlyphs (0, cachedGlyphs.getNumGlyphs(), 0.0f, 0.0f, (float) textBounds.getWidth(), (float) textBounds.getHeight(), juce::Justification::left);
+            }
 
-            g.drawText (name, textIndent, itemArea.getY(), w - textIndent, itemArea.getHeight(), juce::Justification::left, true);
+            cachedGlyphs.draw (g, juce::AffineTransform::translation ((float) textIndent, (float) itemArea.getY()));
         }
 
         // must override to set the disclosure triangle color
@@ -207,89 +276,122 @@ namespace melatonin
             }
         }
 
-        [[nodiscard]] int countItemsRecursively() const noexcept
+        // opens every branch leading to a search result and selects the first one whose name starts with the search
+        void revealSearchResults (const juce::String& searchString)
         {
-            int total = 1;
+            TRACE_COMPONENT();
+            jassert (filter != nullptr);
 
-            for (int i = 0; i < getNumSubItems(); ++i)
+            ComponentTreeViewItem* firstPrefixMatch = nullptr;
+            revealSearchResults (searchString, firstPrefixMatch);
+
+            if (firstPrefixMatch != nullptr)
             {
-                auto item = dynamic_cast<ComponentTreeViewItem*> (getSubItem (i));
-                total += item->countItemsRecursively();
+                outlineComponentCallback (firstPrefixMatch->component);
+                firstPrefixMatch->forceSelectAndOpen();
             }
-
-            return total;
         }
 
-        void filterNodesRecursively (const juce::String& searchString)
+        // componentString is a chain of casts and lookups, so it's computed once per change
+        const juce::String& getDisplayName()
         {
-            TRACE_COMPONENT();
-
-            // Iterate over the child nodes of the current node
-            for (int i = getNumSubItems() - 1; i >= 0; --i)
-            {
-                // Recursively call the function on the current child node
-                if (auto* ct = dynamic_cast<ComponentTreeViewItem*> (getSubItem (i)))
-                {
-                    ct->filterNodesRecursively (searchString);
-                }
-            }
-            // Check if the current node's name does not contain the search string
-            if (!getComponentName().containsIgnoreCase (searchString))
-            {
-                // Remove the subtree rooted at the current node
-                if (getParentItem() != nullptr && getNumSubItems() == 0)
-                {
-                    getParentItem()->removeSubItem (getIndexInParent());
-                }
-                else
-                    setOpen (true);
-            }
-            else if (getComponentName().startsWithIgnoreCase (searchString))
-            {
-                outlineComponentCallback (component);
-                forceSelectAndOpen();
-                setOpen (true);
-            }
-            else
+            if (!displayNameIsValid)
             {
-                setOpen (true);
+                displayName = componentString (component);
+                displayNameIsValid = true;
             }
+            return displayName;
+        }
+
+        void componentNameChanged (juce::Component& /*component*/) override
+        {
+            invalidateDisplayName();
         }
 
         // Callback from the component listener. Reconstruct children when component is deleted
         void componentChildrenChanged (juce::Component& /*changedComponent*/) override
         {
-            validateSubItems();
+            if (scheduler)
+                scheduler->markDirty (this);
+            else
+                validateSubItems();
         }
 
-        void validateSubItems()
+        // a pending update for a deleted component would otherwise walk a dangling child list
+        void componentBeingDeleted (juce::Component& /*component*/) override
         {
-            // Ideally we'd just re-render the sub-items branch:
-            // auto subItemToValidate = dynamic_cast<ComponentTreeViewItem*> (getSubItem (i));
-
-            // However, that wasn't working so the scorched earth strategy is
-            // if any child has a deleted component, we re-render the whole branch
-            // (we don't explicitly know if things were added or removed)
-            clearSubItems();
-            addItemsForChildComponents();
+            if (scheduler)
+                scheduler->forget (this);
         }
 
-        juce::String getComponentName()
+        void validateSubItems()
         {
-            juce::String res = "";
-            if (component && !component->getName().isEmpty())
+            // our parent removes us when it validates
+            if (component == nullptr)
+                return;
+
+            // nothing built yet, just let the tree know we might have gained or lost children
+            if (!subItemsBuilt)
             {
-                return component->getName();
+                treeHasChanged();
+                return;
             }
-            else if (component)
+
+            // diff the existing items against the children, keyed by component,
+            // so unchanged items (and their openness + selection) survive
+            std::vector<juce::Component*> children;
+            forEachChildToDisplay (component, [&] (juce::Component* child) { children.push_back (child); });
+
+            std::set<juce::Component*> wanted (children.begin(), children.end());
+            std::map<juce::Component*, ComponentTreeViewItem*> existing;
+            for (int i = getNumSubItems() - 1; i >= 0; --i)
             {
-                return type (*component);
+                auto* item = dynamic_cast<ComponentTreeViewItem*> (getSubItem (i));
+                auto* c = item ? item->component.getComponent() : nullptr;
+                if (c == nullptr || wanted.count (c) == 0 || existing.count (c) > 0)
+                    removeSubItem (i);
+                else
+                    existing[c] = item;
+            }
+
+            for (int pos = 0; pos < (int) children.size(); ++pos)
+            {
+                auto* child = children[(size_t) pos];
+                auto found = existing.find (child);
+
+                if (found == existing.end())
+                {
+                    addSubItem (new ComponentTreeViewItem (child, outlineComponentCallback, selectComponentCallback, scheduler, filter), pos);
+                }
+                else if (getSubItem (pos) != found->second)
+                {
+                    // reordered: move the item without deleting it
+                    removeSubItem (found->second->getIndexInParent(), false);
+                    addSubItem (found->second, pos);
+                }
             }
-            return res;
+        }
+
+        juce::String getComponentName()
+        {
+            return getComponentName (component);
+        }
+
+        static juce::String getComponentName (juce::Component* c)
+        {
+            if (c && !c->getName().isEmpty())
+                return c->getName();
+            else if (c)
+                return type (*c);
+
+            return {};
         }
 
         int getItemHeight() const override
         {
+            if (filter && !filter->shows (component.getComponent()))
+                return 0;
+
             auto normalItemHeight = 28;
 
             // root has top padding
@@ -301,26 +403,61 @@ namespace melatonin
 
     private:
         juce::Component::SafePointer<juce::Component> component;
+        TreeUpdateScheduler* scheduler = nullptr;
+        const TreeSearchFilter* filter = nullptr;
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComponentTreeViewItem)
         constexpr static int additionalTextIndent = 18;
         bool selectable = false;
+        bool subItemsBuilt = false;
         juce::Rectangle<float> disclosureRect;
 
-        void recursivelyAddChildrenFor (juce::Component* child)
+        juce::String displayName;
+        bool displayNameIsValid = false;
+        juce::GlyphArrangement cachedGlyphs;
+        juce::Rectangle<int> cachedTextBounds;
+
+        static const juce::Font& getRowFont()
+        {
+            static const juce::Font font = InspectorLookAndFeel::getInspectorFont (15, juce::Font::FontStyleFlags::plain);
+            return font;
+        }
+
+        void invalidateDisplayName()
         {
-            // Components such as Labels can have a nullptr component child
-            // Rather than display empty placeholders in the tree view, we will hide them
-            if (child)
-                addSubItem (new ComponentTreeViewItem (child, outlineComponentCallback, selectComponentCallback));
+            displayNameIsValid = false;
+            cachedTextBounds = {};
+            repaintItem();
+        }
+
+        void labelTextChanged (juce::Label*) override
+        {
+            invalidateDisplayName();
         }
 
         void addItemsForChildComponents()
         {
-            for (int i = 0; i < component->getNumChildComponents(); ++i)
+            forEachChildToDisplay (component, [this] (juce::Component* child) {
+                addSubItem (new ComponentTreeViewItem (child, outlineComponentCallback, selectComponentCallback, scheduler, filter));
+            });
+        }
+
+        void revealSearchResults (const juce::String& searchString, ComponentTreeViewItem*& firstPrefixMatch)
+        {
+            if (firstPrefixMatch == nullptr && getComponentName().startsWithIgnoreCase (searchString))
+                firstPrefixMatch = this;
+
+            bool hasVisibleChildren = false;
+            forEachChildToDisplay (component, [&] (juce::Component* child) { hasVisibleChildren |= filter->shows (child); });
+            if (!hasVisibleChildren)
+                return;
+
+            setOpen (true);
+            ensureSubItemsAreBuilt();
+            for (int i = 0; i < getNumSubItems(); ++i)
             {
-                auto child = component->getChildComponent (i);
-                if (componentString (child) != "Melatonin Overlay")
-                    recursivelyAddChildrenFor (child);
+                auto* item = dynamic_cast<ComponentTreeViewItem*> (getSubItem (i));
+                if (item && filter->shows (item->component.getComponent()))
+                    item->revealSearchResults (searchString, firstPrefixMatch);
             }
         }
 
@@ -374,4 +511,15 @@ namespace melatonin
 //            moveItems (*getOwnerView(), selectedTrees, tree, insertIndex, undoManager);
         }
     };
+
+    inline void TreeUpdateScheduler::handleAsyncUpdate()
+    {
+        // validating a parent can delete a dirty child, which then forgets itself
+        while (!dirty.empty())
+        {
+            auto* item = *dirty.begin();
+            dirty.erase (dirty.begin());
+            item->validateSubItems();
+        }
+    }
 }
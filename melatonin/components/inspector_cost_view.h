@@ -0,0 +1,108 @@
+#pragma once
+#include "../helpers/inspector_cost.h"
+#include "../helpers/inspector_settings.h"
+#include "../lookandfeel.h"
+
+namespace melatonin
+{
+    // How much of every frame the inspector itself takes, per subsystem, against the budget
+    // Clicking the budget cycles through a few sensible values
+    class InspectorCostView : public juce::Component, private juce::Timer
+    {
+    public:
+        InspectorCostView()
+        {
+            InspectorCost::getInstance().setBudget (settings->props->getDoubleValue ("inspectorCostBudget", 5.0) / 100.0);
+        }
+
+        void paint (juce::Graphics& g) override
+        {
+            TRACE_COMPONENT();
+
+            auto& cost = InspectorCost::getInstance();
+            auto budget = cost.getBudget();
+            auto area = getLocalBounds().withTrimmedRight (8);
+
+            g.setFont (InspectorLookAndFeel::getInspectorFont (13, juce::Font::FontStyleFlags::plain));
+            for (int i = 0; i < InspectorCost::numSubsystems; ++i)
+                drawRow (g, area.removeFromTop (rowHeight), InspectorCost::getName (i), cost.getShare (i), budget);
+
+            auto total = cost.getTotalShare();
+            auto overBudget = cost.isOverBudget();
+            area.removeFromTop (4);
+
+            g.setFont (InspectorLookAndFeel::getInspectorFont (13, juce::Font::FontStyleFlags::bold));
+            drawRow (g, area.removeFromTop (rowHeight), "Total", total, budget);
+
+            budgetBounds = area.removeFromTop (rowHeight);
+            g.setFont (InspectorLookAndFeel::getInspectorFont (13, juce::Font::FontStyleFlags::plain));
+            g.setColour (overBudget ? colors::propertyValueError : colors::propertyName);
+            auto text = "Budget " + juce::String (budget * 100, 0) + "% of frame time";
+            if (overBudget)
+                text << ", throttling snapshots + live updates";
+            g.drawText (text, budgetBounds, juce::Justification::centredLeft);
+        }
+
+        void mouseDown (const juce::MouseEvent& event) override
+        {
+            if (!budgetBounds.contains (event.getPosition()))
+                return;
+
+            auto& cost = InspectorCost::getInstance();
+            auto current = juce::roundToInt (cost.getBudget() * 100);
+            auto next = budgets[0];
+            for (auto b : budgets)
+                if (b > current)
+                {
+                    next = b;
+                    break;
+                }
+
+            cost.setBudget (next / 100.0);
+            settings->props->setValue ("inspectorCostBudget", next);
+            repaint();
+        }
+
+        // only refreshes while the panel is open
+        void visibilityChanged() override
+        {
+            if (isVisible())
+                startTimer (InspectorCost::windowMs);
+            else
+                stopTimer();
+        }
+
+        static constexpr int rowHeight = 18;
+        static constexpr int preferredHeight = rowHeight * (InspectorCost::numSubsystems + 2) + 12;
+
+    private:
+        juce::SharedResourcePointer<InspectorSettings> settings;
+        juce::Rectangle<int> budgetBounds;
+        static constexpr int budgets[] = { 2, 5, 10, 20 };
+
+        void timerCallback() override
+        {
+            repaint();
+        }
+
+        static void drawRow (juce::Graphics& g, juce::Rectangle<int> row, const juce::String& name, double share, double budget)
+        {
+            g.setColour (colors::propertyName);
+            g.drawText (name, row.removeFromLeft (130), juce::Justification::centredLeft);
+
+            // percent of the frame, and what that is at 60fps
+            g.setColour (colors::propertyValue);
+            auto text = juce::String (share * 100, 2) + "%  " + juce::String (share * 1000.0 / 60.0, 2) + "ms";
+            g.drawText (text, row.removeFromRight (110), juce::Justification::centredRight);
+
+            // the bar fills up at the budget
+            auto bar = row.reduced (6, 6).toFloat();
+            g.setColour (colors::black);
+            g.fillRoundedRectangle (bar, 2);
+
+            auto fill = (float) juce::jlimit (0.0, 1.0, share / budget);
+            g.setColour (colors::overlayBoundingBox.interpolatedWith (colors::propertyValueError, fill));
+            g.fillRoundedRectangle (bar.withWidth (bar.getWidth() * fill), 2);
+        }
+    };
+}
@@ -1,5 +1,8 @@
 #pragma once
+#include "../helpers/inspector_cost.h"
 #include "../helpers/misc.h"
+#include "../helpers/snap_guides.h"
+#include "paint_heatmap.h"
 #include "../lookandfeel.h"
 
 namespace melatonin
@@ -49,6 +52,12 @@ namespace melatonin
         void paint (juce::Graphics& g) override
         {
             TRACE_COMPONENT();
+            InspectorCost::Scope cost (InspectorCost::overlayPaint);
+
+            // underneath everything else
+            if (heatmap.isEnabled())
+                heatmap.paint (g);
+
             g.setColour (colors::overlayBoundingBox);
 
             // draws inwards as the line thickens
@@ -106,6 +115,10 @@ namespace melatonin
                 if (distanceToRightHoveredLabel.isVisible())
                     g.fillRoundedRectangle (distanceToRightLabelBounds.withBottom (distanceToRightLabelBounds.getBottom()).toFloat(), 2.0f);
             }
+
+            g.setColour (colors::overlaySnapGuide);
+            for (auto& guide : guideLines)
+                g.drawLine (guide, 1.0f);
         }
 
         void resized() override
@@ -133,7 +146,7 @@ namespace melatonin
             if (outlinedComponent)
                 outlinedBounds = getLocalAreaForOutline (component);
 
-            repaint();
+            repaintChangedRegions();
         }
 
         void resetDistanceLinesToHovered()
@@ -168,7 +181,7 @@ namespace melatonin
                 resetDistanceLinesToHovered();
             }
 
-            repaint();
+            repaintChangedRegions();
         }
 
         void selectComponent (Component* component)
@@ -200,7 +213,7 @@ namespace melatonin
             setupResizableComponent (selectedComponent);
 
             setSelectedAndResizeableBounds (component);
-            repaint();
+            repaintChangedRegions();
         }
 
         void setupResizableComponent (Component* component)
@@ -247,13 +260,20 @@ namespace melatonin
                 return;
 
             selectedComponent->setMouseCursor (juce::MouseCursor::NormalCursor);
-            repaint();
+            repaintChangedRegions();
         }
 
         void mouseUp (const juce::MouseEvent& event) override
         {
             Component::mouseUp (event);
             isDragging = false;
+
+            snapGuides.clear();
+            if (!guideLines.empty())
+            {
+                guideLines.clear();
+                repaintChangedRegions();
+            }
         }
 
         void mouseEnter (const juce::MouseEvent&) override
@@ -262,7 +282,6 @@ namespace melatonin
                 return;
 
             selectedComponent->setMouseCursor (juce::MouseCursor::DraggingHandCursor);
-            repaint();
         }
 
         void mouseMove (const juce::MouseEvent&) override
@@ -270,7 +289,6 @@ namespace melatonin
             if (!selectedComponent || !isDraggingEnabled)
                 return;
             selectedComponent->setMouseCursor (juce::MouseCursor::DraggingHandCursor);
-            repaint();
         }
 
         void startDraggingComponent (const juce::MouseEvent& e)
@@ -279,6 +297,8 @@ namespace melatonin
             if (selectedComponent && selectedComponent->getLocalBounds().contains (e.getEventRelativeTo (selectedComponent).getPosition()))
             {
                 componentDragger.startDraggingComponent (selectedComponent, e);
+                mouseDownWithinSelected = e.getEventRelativeTo (selectedComponent).getMouseDownPosition();
+                snapGuides.build (*selectedComponent);
                 isDragging = true;
             }
         }
@@ -291,10 +311,26 @@ namespace melatonin
             if (isInside || (selectedComponent && isDragging))
             {
                 isDragging = true;
-                componentDragger.dragComponent (selectedComponent, e, nullptr/*&constrainer*/);
+
+                // holding cmd (ctrl on windows) drags freely
+                if (e.mods.isCommandDown())
+                {
+                    guideLines.clear();
+                    componentDragger.dragComponent (selectedComponent, e, nullptr/*&constrainer*/);
+                    repaintChangedRegions();
+                    return;
+                }
+
+                snapDraggedComponent (e);
             }
         }
 
+        // colours every timed component by its recent paint time
+        void showHeatmap (bool shouldShow, PaintHeatmap::Metric metric)
+        {
+            heatmap.setEnabled (shouldShow, metric);
+        }
+
         void enableDragging (bool enableDragging)
         {
             isDraggingEnabled = enableDragging;
@@ -314,6 +350,9 @@ namespace melatonin
         bool isDragging = false;
         bool isDraggingEnabled = false;
         juce::ComponentDragger componentDragger;
+        juce::Point<int> mouseDownWithinSelected;
+        SnapGuides snapGuides;
+        std::vector<juce::Line<float>> guideLines; // in our coordinates
         juce::ComponentBoundsConstrainer constrainer;
 
         Component::SafePointer<Component> selectedComponent;
@@ -343,6 +382,102 @@ namespace melatonin
         juce::Label dimensions;
         juce::Rectangle<int> dimensionsLabelBounds;
 
+        // repaints its own cells as they change
+        PaintHeatmap heatmap { *this };
+
+        // what paint() drew last time, so it can be erased without invalidating the whole root
+        juce::RectangleList<int> paintedRegions;
+
+        // repaints what we drew before and what we'll draw now
+        // outlines are repainted as thin strips, the inside of a large component is untouched
+        void repaintChangedRegions()
+        {
+            auto regions = getPaintedRegions();
+
+            for (auto& region : paintedRegions)
+                repaint (region);
+            for (auto& region : regions)
+                repaint (region);
+
+            paintedRegions.swapWith (regions);
+        }
+
+        // mirrors paint()
+        juce::RectangleList<int> getPaintedRegions() const
+        {
+            juce::RectangleList<int> regions;
+
+            if (outlinedComponent)
+                addOutline (regions, outlinedBounds, 2);
+
+            if (selectedComponent)
+            {
+                // includes the corner handles, which sit 4px outside
+                addOutline (regions, selectedBounds.expanded (4), 9);
+                addLine (regions, lineFromTopToParent, 1.0f);
+                addLine (regions, lineFromLeftToParent, 1.0f);
+                regions.add (dimensionsLabelBounds);
+            }
+
+            if (!hoveredBounds.isEmpty())
+            {
+                addOutline (regions, hoveredBounds, 2);
+                addOutline (regions, selectedBounds, 2);
+
+                for (auto* line : { &lineToTopHoveredComponent, &lineToLeftHoveredComponent, &lineToRightHoveredComponent, &lineToBottomHoveredComponent, &horConnectingLineToComponent, &vertConnectingLineToComponent })
+                    addLine (regions, *line, 2.0f);
+
+                for (auto* labelBounds : { &distanceToTopLabelBounds, &distanceToBottomLabelBounds, &distanceToLeftLabelBounds, &distanceToRightLabelBounds })
+                    regions.add (*labelBounds);
+            }
+
+            for (auto& guide : guideLines)
+                addLine (regions, guide, 1.0f);
+
+            return regions;
+        }
+
+        static void addOutline (juce::RectangleList<int>& regions, juce::Rectangle<int> bounds, int thickness)
+        {
+            if (bounds.isEmpty())
+                return;
+
+            regions.add (bounds.withHeight (thickness));
+            regions.add (bounds.withTop (bounds.getBottom() - thickness));
+            regions.add (bounds.withWidth (thickness));
+            regions.add (bounds.withLeft (bounds.getRight() - thickness));
+        }
+
+        static void addLine (juce::RectangleList<int>& regions, juce::Line<float> line, float thickness)
+        {
+            if (line.getLength() <= 0)
+                return;
+
+            regions.add (juce::Rectangle<float> (line.getStart(), line.getEnd()).expanded (thickness).getSmallestIntegerContainer());
+        }
+
+        // same maths as ComponentDragger, but the new bounds go through the snap guides first
+        void snapDraggedComponent (const juce::MouseEvent& e)
+        {
+            TRACE_COMPONENT();
+
+            auto* parent = selectedComponent->getParentComponent();
+            if (!snapGuides.isBuiltFor (parent))
+                snapGuides.build (*selectedComponent);
+
+            auto delta = e.getEventRelativeTo (selectedComponent).getPosition() - mouseDownWithinSelected;
+            auto snapped = snapGuides.snap (selectedComponent->getBounds() + delta);
+
+            guideLines.clear();
+            for (auto& guide : snapGuides.getGuides())
+                guideLines.emplace_back (getLocalPoint (parent, guide.getStart()).toFloat(), getLocalPoint (parent, guide.getEnd()).toFloat());
+
+            selectedComponent->setBounds (snapped);
+
+            // the guides can change without the component moving
+            repaintChangedRegions();
+        }
+
         juce::Rectangle<int> getLocalAreaForOutline (Component* component, int borderSize = 2)
         {
             auto boundsPlusOutline = component->getBounds().expanded (borderSize);
@@ -399,7 +534,7 @@ namespace melatonin
             calculateLinesToParent();
             if (resizable)
                 resizable->setBounds (selectedBounds);
-            repaint();
+            repaintChangedRegions();
         }
 
         void drawDistanceLabel()
@@ -599,6 +734,8 @@ namespace melatonin
         void deselectComponent()
         {
             dimensions.setVisible (false);
+            snapGuides.clear();
+            guideLines.clear();
 
             if (selectedComponent != nullptr)
             {
@@ -608,7 +745,7 @@ namespace melatonin
             }
 
             selectedComponent = nullptr;
-            repaint();
+            repaintChangedRegions();
         }
     };
 
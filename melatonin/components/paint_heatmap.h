@@ -0,0 +1,212 @@
+#pragma once
+#include "../helpers/component_helpers.h"
+#include "../helpers/timing.h"
+#include "../lookandfeel.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+namespace melatonin
+{
+    // Colours every timed component by its recent paint cost, like a thermal camera over the UI
+    //
+    // Timings are read at a low fixed rate and cached along with the colour band they map to,
+    // so painting is a loop over rectangles. Only cells whose band (or label) changed are
+    // repainted: repainting the overlay repaints whatever is under it too, which would
+    // otherwise add paints to the very timings being shown.
+    class PaintHeatmap : private juce::Timer
+    {
+    public:
+        enum class Metric
+        {
+            p95,
+            mean
+        };
+
+        static constexpr int refreshHz = 4;
+
+        // the scale is logarithmic, anything outside these is as cool or hot as it gets
+        static constexpr double coolSeconds = 0.05 / 1000;
+        static constexpr double hotSeconds = 4.0 / 1000;
+        static constexpr int numBands = 16;
+
+        // the hottest few get their time written on them
+        static constexpr int numLabelled = 3;
+
+        explicit PaintHeatmap (juce::Component& o) : overlay (o) {}
+
+        ~PaintHeatmap() override
+        {
+            stopTimer();
+        }
+
+        void setEnabled (bool shouldBeEnabled, Metric newMetric)
+        {
+            metric = newMetric;
+            if (shouldBeEnabled)
+            {
+                startTimerHz (refreshHz);
+                refresh();
+            }
+            else
+            {
+                stopTimer();
+                update ({});
+            }
+        }
+
+        [[nodiscard]] bool isEnabled() const noexcept { return isTimerRunning(); }
+
+        void paint (juce::Graphics& g) const
+        {
+            TRACE_COMPONENT();
+
+            g.setFont (InspectorLookAndFeel::getInspectorFont (11, juce::Font::FontStyleFlags::bold));
+            for (auto& cell : cells)
+            {
+                auto colour = colourForBand (cell.band);
+                g.setColour (colour.withAlpha (0.35f));
+                g.fillRect (cell.bounds);
+                g.setColour (colour.withAlpha (0.9f));
+                g.drawRect (cell.bounds, 1);
+
+                if (cell.label.isNotEmpty())
+                {
+                    auto labelBounds = labelBoundsFor (cell.bounds);
+                    g.setColour (colors::black.withAlpha (0.75f));
+                    g.fillRect (labelBounds);
+                    g.setColour (colour);
+                    g.drawText (cell.label, labelBounds, juce::Justification::centred, false);
+                }
+            }
+        }
+
+    private:
+        struct Cell
+        {
+            juce::Component* component; // only used as a key, never dereferenced
+            juce::Rectangle<int> bounds; // in the overlay's coordinates, clipped by ancestors
+            double seconds;
+            int band;
+            juce::String label;
+        };
+
+        juce::Component& overlay;
+        Metric metric = Metric::p95;
+        std::vector<Cell> cells; // parents before children, the paint order
+
+        void timerCallback() override
+        {
+            refresh();
+        }
+
+        void refresh()
+        {
+            TRACE_COMPONENT();
+
+            std::vector<Cell> fresh;
+            auto* root = overlay.getParentComponent();
+            if (root != nullptr && overlay.isVisible())
+                collect (root, root->getLocalBounds(), fresh);
+
+            // label the hottest few, unless they're too small to hold the text
+            std::vector<Cell*> hottest;
+            for (auto& cell : fresh)
+                if (cell.bounds.getWidth() >= 44 && cell.bounds.getHeight() >= 16)
+                    hottest.push_back (&cell);
+
+            auto numToLabel = juce::jmin ((int) hottest.size(), numLabelled);
+            std::partial_sort (hottest.begin(), hottest.begin() + numToLabel, hottest.end(), [] (Cell* a, Cell* b) { return a->seconds > b->seconds; });
+            for (int i = 0; i < numToLabel; ++i)
+                hottest[(size_t) i]->label = juce::String (hottest[(size_t) i]->seconds * 1000, 2) + "ms";
+
+            update (std::move (fresh));
+        }
+
+        void collect (juce::Component* c, juce::Rectangle<int> clip, std::vector<Cell>& fresh) const
+        {
+            for (auto* child : c->getChildren())
+            {
+                if (!child->isVisible() || isInspectorOverlay (child))
+                    continue;
+
+                auto bounds = overlay.getLocalArea (c, child->getBounds()).getIntersection (clip);
+                if (bounds.isEmpty())
+                    continue;
+
+                if (auto* timing = ComponentTiming::find (child); timing != nullptr && timing->getNumSamples() > 0)
+                {
+                    auto seconds = metric == Metric::mean ? timing->getRecentMean() : timing->getRecentPercentile (95);
+                    fresh.push_back ({ child, bounds, seconds, bandFor (seconds), {} });
+                }
+
+                collect (child, bounds, fresh);
+            }
+        }
+
+        // repaints only what changed between the cached cells and the fresh ones
+        void update (std::vector<Cell> fresh)
+        {
+            std::unordered_map<juce::Component*, const Cell*> previous;
+            for (auto& cell : cells)
+                previous[cell.component] = &cell;
+
+            juce::RectangleList<int> dirty;
+            for (auto& cell : fresh)
+            {
+                auto found = previous.find (cell.component);
+                if (found == previous.end())
+                {
+                    dirty.add (cell.bounds);
+                    continue;
+                }
+
+                auto& old = *found->second;
+                if (old.bounds != cell.bounds || old.band != cell.band)
+                {
+                    dirty.add (old.bounds);
+                    dirty.add (cell.bounds);
+                }
+                else if (old.label != cell.label)
+                {
+                    // a new time on the same colour, don't repaint a large component for it
+                    dirty.add (labelBoundsFor (cell.bounds));
+                }
+                previous.erase (found);
+            }
+
+            // gone, hidden or no longer timed
+            for (auto& [component, old] : previous)
+                dirty.add (old->bounds);
+
+            cells = std::move (fresh);
+
+            dirty.consolidate();
+            for (auto& area : dirty)
+                overlay.repaint (area);
+        }
+
+        static int bandFor (double seconds)
+        {
+            auto t = std::log (juce::jlimit (coolSeconds, hotSeconds, seconds) / coolSeconds) / std::log (hotSeconds / coolSeconds);
+            return juce::jlimit (0, numBands - 1, (int) (t * numBands));
+        }
+
+        static juce::Colour colourForBand (int band)
+        {
+            static const juce::ColourGradient gradient = [] {
+                juce::ColourGradient g (colors::overlayBoundingBox, 0, 0, colors::propertyValueError, 1, 0, false);
+                g.addColour (0.6, colors::highlight);
+                return g;
+            }();
+
+            return gradient.getColourAtPosition ((double) band / (numBands - 1));
+        }
+
+        static juce::Rectangle<int> labelBoundsFor (juce::Rectangle<int> bounds)
+        {
+            return bounds.reduced (2).removeFromTop (14).removeFromLeft (52);
+        }
+    };
+}
@@ -0,0 +1,353 @@
+#pragma once
+#include "../helpers/component_helpers.h"
+#include "../helpers/inspector_cost.h"
+#include "../helpers/inspector_settings.h"
+#include "../helpers/paint_profiler.h"
+#include "../lookandfeel.h"
+#include "fps_meter.h"
+#include <unordered_set>
+#include <vector>
+
+namespace melatonin
+{
+    // small text button, drawn like the RGBA toggle
+    class ProfilerButton : public juce::Component
+    {
+    public:
+        bool on = false;
+        std::function<void()> onClick;
+
+        ProfilerButton (juce::String offText, juce::String onText = {}) : textWhenOff (std::move (offText)), textWhenOn (std::move (onText))
+        {
+        }
+
+        void paint (juce::Graphics& g) override
+        {
+            g.setColour (colors::customBackground);
+            g.fillRoundedRectangle (getLocalBounds().reduced (2, 4).toFloat(), 3);
+            g.setColour (on ? colors::highlight : colors::label);
+            g.setFont (InspectorLookAndFeel::getInspectorFont (9, juce::Font::FontStyleFlags::bold));
+            g.drawText (on && textWhenOn.isNotEmpty() ? textWhenOn : textWhenOff, getLocalBounds(), juce::Justification::centred);
+        }
+
+        void mouseDown (const juce::MouseEvent&) override
+        {
+            if (textWhenOn.isNotEmpty())
+                on = !on;
+            if (onClick)
+                onClick();
+            repaint();
+        }
+
+    private:
+        juce::String textWhenOff, textWhenOn;
+    };
+
+    // Records every ComponentTimer paint per frame and draws a chosen frame
+    // as an icicle chart: x is time within the frame, rows are timed ancestor depth
+    // ComponentTimer only covers a component's own paint(), so children show up
+    // on the row below and after their parent's bar, not inside it
+    class PaintProfilerView : public juce::Component, private juce::Timer
+    {
+    public:
+        std::function<void (juce::Component*)> selectComponentCallback;
+        std::function<void (bool enabled, bool useMean)> heatmapCallback;
+
+        PaintProfilerView()
+        {
+            addAndMakeVisible (recordButton);
+            addAndMakeVisible (previousButton);
+            addAndMakeVisible (nextButton);
+            addAndMakeVisible (slowestButton);
+            addAndMakeVisible (heatmapButton);
+            addAndMakeVisible (metricButton);
+
+            recordButton.onClick = [this] { setRecording (recordButton.on); };
+            previousButton.onClick = [this] { showFrame (frameIndex - 1); };
+            nextButton.onClick = [this] { showFrame (frameIndex + 1); };
+            slowestButton.onClick = [this] { showFrame (PaintProfiler::getInstance().getSlowestFrameIndex()); };
+
+            // the overlay itself is restored by the inspector
+            heatmapButton.on = settings->props->getBoolValue ("showHeatmap", false);
+            metricButton.on = settings->props->getValue ("heatmapMetric", "p95") == "mean";
+            heatmapButton.onClick = [this] { heatmapChanged(); };
+            metricButton.onClick = [this] { heatmapChanged(); };
+        }
+
+        ~PaintProfilerView() override
+        {
+            setRecording (false);
+        }
+
+        void setRoot (juce::Component* newRoot)
+        {
+            setRecording (false);
+            root = newRoot;
+        }
+
+        void paint (juce::Graphics& g) override
+        {
+            TRACE_COMPONENT();
+
+            auto& profiler = PaintProfiler::getInstance();
+            g.setFont (InspectorLookAndFeel::getInspectorFont (13, juce::Font::FontStyleFlags::plain));
+            g.setColour (colors::propertyName);
+
+            if (recordButton.on)
+            {
+                g.drawText ("Recording... " + juce::String (profiler.getNumFrames()) + " frames", infoBounds, juce::Justification::centredLeft);
+                return;
+            }
+
+            if (!juce::isPositiveAndBelow (frameIndex, profiler.getNumFrames()))
+            {
+                g.drawText ("Record to capture ComponentTimer paints per frame", infoBounds, juce::Justification::centredLeft);
+                return;
+            }
+
+            auto& frame = profiler.getFrame (frameIndex);
+            auto frameTicks = (double) juce::jmax ((juce::int64) 1, frame.endTicks - frame.startTicks);
+
+            if (auto* hovered = getHoveredEvent (frame))
+            {
+                auto seconds = juce::Time::highResolutionTicksToSeconds (hovered->endTicks - hovered->startTicks);
+                g.drawText (componentString (componentFor (hoveredEventIndex)) + "  " + juce::String (seconds * 1000, 2) + "ms", infoBounds, juce::Justification::centredLeft);
+            }
+            else
+            {
+                auto text = "Frame " + juce::String (frameIndex + 1) + "/" + juce::String (profiler.getNumFrames())
+                            + "  " + juce::String (frame.getPaintSeconds() * 1000, 2) + "ms in " + juce::String (frame.numEvents) + " paints";
+                if (frame.numDropped > 0)
+                    text << " (" << frame.numDropped << " dropped)";
+                g.drawText (text, infoBounds, juce::Justification::centredLeft);
+            }
+
+            g.setColour (colors::black);
+            g.fillRect (graphBounds);
+
+            g.setFont (InspectorLookAndFeel::getInspectorFont (10, juce::Font::FontStyleFlags::plain));
+            for (int i = 0; i < frame.numEvents; ++i)
+            {
+                auto& event = frame.events[(size_t) i];
+                auto bar = barFor (event, frame, frameTicks);
+                if (!bar.intersects (graphBounds.toFloat()))
+                    continue;
+
+                // hotter colour for the larger share of the frame
+                auto share = (float) ((double) (event.endTicks - event.startTicks) / frameTicks);
+                g.setColour (colors::overlayBoundingBox.interpolatedWith (colors::propertyValueError, juce::jlimit (0.0f, 1.0f, share * 4.0f)));
+                g.fillRect (bar.reduced (0.5f, 0.5f));
+
+                if (i == hoveredEventIndex)
+                {
+                    g.setColour (colors::highlight);
+                    g.drawRect (bar, 1.0f);
+                }
+
+                if (auto* component = componentFor (i); bar.getWidth() > 30 && component != nullptr)
+                {
+                    g.setColour (colors::black);
+                    g.drawText (componentString (component), bar.reduced (2, 0), juce::Justification::centredLeft, true);
+                }
+            }
+        }
+
+        void resized() override
+        {
+            auto area = getLocalBounds();
+            auto toolbar = area.removeFromTop (24);
+            recordButton.setBounds (toolbar.removeFromLeft (44));
+            previousButton.setBounds (toolbar.removeFromLeft (24));
+            nextButton.setBounds (toolbar.removeFromLeft (24));
+            slowestButton.setBounds (toolbar.removeFromLeft (56));
+            metricButton.setBounds (toolbar.removeFromRight (36));
+            heatmapButton.setBounds (toolbar.removeFromRight (58));
+            toolbar.removeFromLeft (6);
+            infoBounds = toolbar;
+            graphBounds = area.withTrimmedTop (4).withTrimmedRight (8);
+        }
+
+        void mouseMove (const juce::MouseEvent& event) override
+        {
+            auto newIndex = eventIndexAt (event.position);
+            if (newIndex != hoveredEventIndex)
+            {
+                hoveredEventIndex = newIndex;
+                repaint();
+            }
+        }
+
+        void mouseExit (const juce::MouseEvent&) override
+        {
+            hoveredEventIndex = -1;
+            repaint();
+        }
+
+        void mouseDown (const juce::MouseEvent& event) override
+        {
+            auto index = eventIndexAt (event.position);
+            if (index < 0 || !selectComponentCallback)
+                return;
+
+            if (auto* component = componentFor (index))
+                selectComponentCallback (component);
+        }
+
+    private:
+        ProfilerButton recordButton { "REC", "STOP" };
+        ProfilerButton previousButton { "<" };
+        ProfilerButton nextButton { ">" };
+        ProfilerButton slowestButton { "SLOWEST" };
+        ProfilerButton heatmapButton { "HEATMAP", "HEATMAP" };
+        ProfilerButton metricButton { "P95", "MEAN" };
+        juce::SharedResourcePointer<InspectorSettings> settings;
+
+        juce::Component::SafePointer<juce::Component> root;
+        juce::Rectangle<int> infoBounds, graphBounds;
+        int frameIndex = -1;
+        int hoveredEventIndex = -1;
+        int framesSinceRepaint = 0;
+        static constexpr float rowHeight = 16.0f;
+
+        // the shown frame's components that still exist, by event index
+        std::vector<juce::Component::SafePointer<juce::Component>> shownComponents;
+
+#if MELATONIN_VBLANK
+        juce::VBlankAttachment vBlankCallback;
+#endif
+
+        void setRecording (bool shouldRecord)
+        {
+            auto& profiler = PaintProfiler::getInstance();
+            recordButton.on = shouldRecord && root != nullptr;
+
+            if (recordButton.on)
+            {
+                profiler.start();
+                frameIndex = -1;
+                shownComponents.clear();
+#if MELATONIN_VBLANK
+                // frame boundaries come from the target app's display
+                vBlankCallback = { root.getComponent(), [this] { frameFinished(); } };
+#else
+                startTimerHz (60);
+#endif
+            }
+            else if (PaintProfiler::isRecording())
+            {
+#if MELATONIN_VBLANK
+                vBlankCallback = {};
+#else
+                stopTimer();
+#endif
+                profiler.stop();
+                frameIndex = profiler.getSlowestFrameIndex();
+                resolveComponents();
+            }
+
+            hoveredEventIndex = -1;
+            repaint();
+        }
+
+        void timerCallback() override
+        {
+            frameFinished();
+        }
+
+        void heatmapChanged()
+        {
+            settings->props->setValue ("showHeatmap", heatmapButton.on);
+            settings->props->setValue ("heatmapMetric", metricButton.on ? "mean" : "p95");
+            if (heatmapCallback)
+                heatmapCallback (heatmapButton.on, metricButton.on);
+        }
+
+        void frameFinished()
+        {
+            PaintProfiler::getInstance().nextFrame();
+
+            // don't let the recording UI dominate what's being recorded
+            if (++framesSinceRepaint >= (InspectorCost::getInstance().isOverBudget() ? 60 : 15))
+            {
+                framesSinceRepaint = 0;
+                repaint (infoBounds);
+            }
+        }
+
+        void showFrame (int index)
+        {
+            auto numFrames = PaintProfiler::getInstance().getNumFrames();
+            if (recordButton.on || numFrames == 0)
+                return;
+
+            frameIndex = juce::jlimit (0, numFrames - 1, index);
+            hoveredEventIndex = -1;
+            resolveComponents();
+            repaint();
+        }
+
+        // recorded pointers are only trusted if they are still somewhere under the root
+        void resolveComponents()
+        {
+            shownComponents.clear();
+
+            auto& profiler = PaintProfiler::getInstance();
+            if (root == nullptr || !juce::isPositiveAndBelow (frameIndex, profiler.getNumFrames()))
+                return;
+
+            std::unordered_set<juce::Component*> live;
+            std::function<void (juce::Component*)> addLive = [&] (juce::Component* c) {
+                live.insert (c);
+                for (auto* child : c->getChildren())
+                    addLive (child);
+            };
+            addLive (root);
+
+            auto& frame = profiler.getFrame (frameIndex);
+            for (int i = 0; i < frame.numEvents; ++i)
+            {
+                auto* component = frame.events[(size_t) i].component;
+                shownComponents.emplace_back (live.count (component) > 0 ? component : nullptr);
+            }
+        }
+
+        juce::Component* componentFor (int eventIndex) const
+        {
+            if (juce::isPositiveAndBelow (eventIndex, (int) shownComponents.size()))
+                return shownComponents[(size_t) eventIndex].getComponent();
+            return nullptr;
+        }
+
+        juce::Rectangle<float> barFor (const PaintProfiler::Event& event, const PaintProfiler::Frame& frame, double frameTicks) const
+        {
+            auto width = (float) graphBounds.getWidth();
+            auto x = (float) graphBounds.getX() + width * (float) ((double) (event.startTicks - frame.startTicks) / frameTicks);
+            auto w = juce::jmax (1.0f, width * (float) ((double) (event.endTicks - event.startTicks) / frameTicks));
+            return { x, (float) graphBounds.getY() + (float) event.depth * rowHeight, w, rowHeight };
+        }
+
+        int eventIndexAt (juce::Point<float> position) const
+        {
+            auto& profiler = PaintProfiler::getInstance();
+            if (recordButton.on || !juce::isPositiveAndBelow (frameIndex, profiler.getNumFrames()))
+                return -1;
+
+            auto& frame = profiler.getFrame (frameIndex);
+            auto frameTicks = (double) juce::jmax ((juce::int64) 1, frame.endTicks - frame.startTicks);
+            for (int i = frame.numEvents; --i >= 0;)
+                if (barFor (frame.events[(size_t) i], frame, frameTicks).contains (position))
+                    return i;
+
+            return -1;
+        }
+
+        const PaintProfiler::Event* getHoveredEvent (const PaintProfiler::Frame& frame) const
+        {
+            if (juce::isPositiveAndBelow (hoveredEventIndex, frame.numEvents))
+                return &frame.events[(size_t) hoveredEventIndex];
+            return nullptr;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PaintProfilerView)
+    };
+}
@@ -5,7 +5,7 @@
 namespace melatonin
 {
 
-    class Preview : public juce::Component, public ComponentModel::Listener
+    class Preview : public juce::Component, public ComponentModel::Listener, private juce::Timer
     {
     public:
         int zoomScale = 20;
@@ -55,25 +55,32 @@ namespace melatonin
                 g.setColour (colors::propertyValueError.withAlpha (0.17f));
                 g.fillRoundedRectangle (maxBounds.toFloat(), 3);
 
-                g.setFont (g.getCurrentFont().withHeight (15.0f));
                 double exclusiveSum = (double) model.timing1.getValue() + (double) model.timing2.getValue() + (double) model.timing3.getValue();
                 bool hasExclusive = exclusiveSum * 1000 * 1000 > 1; // at least 1 microsecond
                 bool hasChildren = model.hasChildren.getValue();
 
+                auto header = headerBounds;
+                drawHistogram (g, header.removeFromLeft (100).withTrimmedRight (12).reduced (0, 2));
+                g.setFont (g.getCurrentFont().withHeight (12.0f));
+                g.setColour (colors::propertyValueDisabled);
+                for (auto* percentile : { "p50", "p95", "p99" })
+                    g.drawText (percentile, header.removeFromLeft (60), juce::Justification::bottomLeft);
+
+                g.setFont (g.getCurrentFont().withHeight (15.0f));
                 auto exclusive = exclusiveBounds;
                 g.setColour (hasExclusive ? colors::propertyName : colors::propertyValueDisabled);
                 g.drawText ("Exclusive", exclusive.removeFromLeft (100), juce::Justification::topLeft);
-                drawTimingText (g, exclusive.removeFromLeft (60), model.timing1.getValue(), !hasExclusive);
-                drawTimingText (g, exclusive.removeFromLeft (60), model.timing2.getValue(), !hasExclusive);
-                drawTimingText (g, exclusive.removeFromLeft (60), model.timing3.getValue(), !hasExclusive);
+                drawTimingText (g, exclusive.removeFromLeft (60), model.timingP50.getValue(), !hasExclusive);
+                drawTimingText (g, exclusive.removeFromLeft (60), model.timingP95.getValue(), !hasExclusive);
+                drawTimingText (g, exclusive.removeFromLeft (60), model.timingP99.getValue(), !hasExclusive);
                 drawTimingText (g, exclusive.removeFromLeft (60), model.timingMax.getValue(), !hasExclusive);
 
                 auto withChildren = withChildrenBounds;
                 g.setColour (hasChildren ? colors::propertyName : colors::propertyValueDisabled);
                 g.drawText ("With Children", withChildren.removeFromLeft (100), juce::Justification::topLeft);
-                drawTimingText (g, withChildren.removeFromLeft (60), model.timingWithChildren1, !hasChildren);
-                drawTimingText (g, withChildren.removeFromLeft (60), model.timingWithChildren2, !hasChildren);
-                drawTimingText (g, withChildren.removeFromLeft (60), model.timingWithChildren3, !hasChildren);
+                drawTimingText (g, withChildren.removeFromLeft (60), model.timingWithChildrenP50, !hasChildren);
+                drawTimingText (g, withChildren.removeFromLeft (60), model.timingWithChildrenP95, !hasChildren);
+                drawTimingText (g, withChildren.removeFromLeft (60), model.timingWithChildrenP99, !hasChildren);
                 drawTimingText (g, withChildren.removeFromLeft (60), model.timingWithChildrenMax, !hasChildren);
             }
             else
@@ -167,7 +174,8 @@ namespace melatonin
 
             if (showsPerformanceTimings())
             {
-                auto performanceBounds = area.removeFromBottom (50).withLeft (32);
+                auto performanceBounds = area.removeFromBottom (66).withLeft (32);
+                headerBounds = performanceBounds.removeFromTop (16);
                 maxBounds = performanceBounds.withLeft (304).withWidth (80).translated (0, -4).withTrimmedBottom (4);
                 auto pivot = maxBounds.getTopRight().toFloat();
                 exclusiveBounds = performanceBounds.removeFromTop (25);
@@ -177,6 +185,7 @@ namespace melatonin
             }
             else
             {
+                headerBounds = juce::Rectangle<int>();
                 exclusiveBounds = juce::Rectangle<int>();
                 withChildrenBounds = juce::Rectangle<int>();
             }
@@ -191,15 +200,8 @@ namespace melatonin
             if (model.getSelectedComponent())
             {
                 // clear timings
-                // TODO: these should be settable from model
-                auto props = model.getSelectedComponent()->getProperties();
                 if (model.hasPerformanceTiming())
-                {
-                    juce::StringArray items = { "timing1", "timing2", "timing3", "timingMax", "timingWithChildren1", "timingWithChildren2", "timingWithChildren3", "timingWithChildrenMax" };
-                    for (auto& item : items)
-                        props.set (item, 0.0);
-                    model.refresh();
-                }
+                    model.resetPerformanceTiming();
 
                 // force repaint to grab new timings
                 model.getSelectedComponent()->repaint();
@@ -220,7 +222,7 @@ namespace melatonin
         void switchToPreview()
         {
             colorPicking = false;
-            componentModelChanged (model);
+            componentModelChanged (model, ComponentModel::everythingChanged);
             repaint();
         }
 
@@ -229,15 +231,24 @@ namespace melatonin
             return !colorPicking && model.hasPerformanceTiming() && timingToggle.on;
         }
 
+        // the next selection of any component takes a fresh snapshot
+        void clearSnapshotCache()
+        {
+            snapshots.clear();
+        }
+
     private:
         juce::Image previewImage;
         juce::Image checkerboard;
         juce::SharedResourcePointer<InspectorSettings> settings;
         ComponentModel& model;
         bool colorPicking = false;
+        juce::uint32 lastSnapshotTime = 0;
+        static constexpr int overBudgetSnapshotIntervalMs = 1000;
 
         juce::Rectangle<int> buttonsBounds;
         juce::Rectangle<int> contentBounds;
+        juce::Rectangle<int> headerBounds;
         juce::Rectangle<int> exclusiveBounds;
         juce::Rectangle<int> withChildrenBounds;
         juce::Rectangle<int> maxBounds;
@@ -245,18 +256,173 @@ namespace melatonin
         InspectorImageButton timingToggle { "timing", { 4, 4 }, true };
         juce::Label maxLabel { "max", "MAX" };
 
-        void componentModelChanged (ComponentModel&) override
+        void componentModelChanged (ComponentModel&, int changes) override
         {
             TRACE_COMPONENT();
 
+            // new timings only need the text redrawn
+            if (changes & ComponentModel::timingChanged)
+            {
+                repaint();
+                changes &= ~ComponentModel::timingChanged;
+            }
+
+            // a move doesn't change what the component looks like
+            if (changes == 0 || changes == ComponentModel::positionChanged)
+                return;
+
+            // snapshots are expensive and animated components resize every frame
+            // over budget, only a new selection is worth a snapshot right away
+            auto overBudget = InspectorCost::getInstance().isOverBudget();
+            auto immediate = overBudget ? ComponentModel::selectionChanged : ComponentModel::selectionChanged | ComponentModel::propertiesChanged;
+            if (!(changes & immediate))
+            {
+                auto interval = 1000 / juce::jmax (1, settings->props->getIntValue ("previewSnapshotHz", 15));
+                if (overBudget)
+                    interval = juce::jmax (interval, overBudgetSnapshotIntervalMs);
+                auto elapsed = (int) (juce::Time::getMillisecondCounter() - lastSnapshotTime);
+                if (elapsed < interval)
+                {
+                    if (!isTimerRunning())
+                        startTimer (interval - elapsed);
+                    return;
+                }
+            }
+
+            // only a new selection can be served from the cache, anything else means the component changed
+            updateSnapshot ((changes & ComponentModel::selectionChanged) != 0);
+        }
+
+        void updateSnapshot (bool allowCached = false)
+        {
+            TRACE_COMPONENT();
+            InspectorCost::Scope cost (InspectorCost::previewSnapshot);
+
+            stopTimer();
+            lastSnapshotTime = juce::Time::getMillisecondCounter();
+
             if (auto component = model.getSelectedComponent())
-                previewImage = component->createComponentSnapshot ({ component->getWidth(), component->getHeight() }, false, 2.0f);
+                previewImage = snapshots.get (*component, snapshotScaleFor (*component), allowCached);
             else
                 previewImage = juce::Image();
 
             colorPicking = false;
+            repaint();
+        }
+
+        void timerCallback() override
+        {
+            updateSnapshot();
         }
 
+        // render no more pixels than end up on screen, and never more than the old fixed 2x (1x when over budget)
+        float snapshotScaleFor (const juce::Component& component) const
+        {
+            if (component.getWidth() <= 0 || component.getHeight() <= 0 || maxPreviewImageBounds.isEmpty())
+                return 1.0f;
+
+            auto fit = juce::jmin ((float) maxPreviewImageBounds.getWidth() / (float) component.getWidth(),
+                (float) maxPreviewImageBounds.getHeight() / (float) component.getHeight());
+
+            auto maxScale = InspectorCost::getInstance().isOverBudget() ? 1.0f : 2.0f;
+            return juce::jlimit (0.01f, maxScale, fit * juce::Component::getApproximateScaleFactorForComponent (this));
+        }
+
+        // the last few snapshots, so hovering back and forth over the same components is free
+        class SnapshotCache
+        {
+        public:
+            juce::Image get (juce::Component& component, float scale, bool allowCached)
+            {
+                auto generation = generationFor (component);
+                auto now = juce::Time::getMillisecondCounter();
+
+                for (size_t i = 0; i < entries.size(); ++i)
+                {
+                    auto& entry = entries[i];
+                    if (entry.component.getComponent() != &component)
+                        continue;
+
+                    if (allowCached && entry.isCurrent (component, scale, generation, now))
+                    {
+                        // most recently used goes to the front
+                        std::rotate (entries.begin(), entries.begin() + (long) i, entries.begin() + (long) i + 1);
+                        return entries.front().image;
+                    }
+
+                    entries.erase (entries.begin() + (long) i);
+                    break;
+                }
+
+                auto image = component.createComponentSnapshot (component.getLocalBounds(), false, scale);
+
+                // taking the snapshot paints (and times) the component, so read the generation afterwards
+                // an untimed component in the subtree could repaint without bumping it, so those age out instead
+                generation = isFullyTimed (component) ? generationFor (component) : 0;
+
+                if (entries.size() == maxEntries)
+                    entries.pop_back();
+                entries.insert (entries.begin(), { &component, component.getLocalBounds(), scale, generation, now, image });
+                return image;
+            }
+
+            void clear()
+            {
+                entries.clear();
+            }
+
+        private:
+            static constexpr size_t maxEntries = 8;
+
+            // components without timings don't tell us when they repaint
+            static constexpr juce::uint32 maxUntimedAgeMs = 1000;
+
+            struct Entry
+            {
+                juce::Component::SafePointer<juce::Component> component;
+                juce::Rectangle<int> bounds;
+                float scale;
+                juce::uint64 generation; // paints of the component and its descendants when all are timed, 0 otherwise
+                juce::uint32 createdAt;
+                juce::Image image;
+
+                [[nodiscard]] bool isCurrent (const juce::Component& c, float neededScale, juce::uint64 currentGeneration, juce::uint32 now) const
+                {
+                    if (c.getLocalBounds() != bounds || scale < neededScale * 0.99f)
+                        return false;
+
+                    if (generation != 0)
+                        return generation == currentGeneration;
+
+                    return now - createdAt < maxUntimedAgeMs;
+                }
+            };
+
+            std::vector<Entry> entries;
+
+            static juce::uint64 generationFor (juce::Component& component)
+            {
+                if (auto timing = ComponentTiming::find (&component))
+                    return timing->getPaintGeneration() + 1;
+                return 0;
+            }
+
+            // only checked after a snapshot, which already visited the whole subtree
+            static bool isFullyTimed (juce::Component& component)
+            {
+                if (ComponentTiming::find (&component) == nullptr)
+                    return false;
+
+                for (auto* child : component.getChildren())
+                    if (child->isVisible() && !isFullyTimed (*child))
+                        return false;
+
+                return true;
+            }
+        };
+
+        SnapshotCache snapshots;
+
         static void drawTimingText (juce::Graphics& g, juce::Rectangle<int> bounds, double value, bool disabled = false)
         {
             auto text = timingWithUnits (disabled ? 0 : value);
@@ -274,6 +440,46 @@ namespace melatonin
             g.drawText (text, bounds, juce::Justification::topLeft);
         }
 
+        // sparkline of every paint of the selected component
+        // bars past the p95 are highlighted, that's where the jank lives
+        void drawHistogram (juce::Graphics& g, juce::Rectangle<int> bounds)
+        {
+            if (model.timing == nullptr)
+                return;
+
+            auto& histogram = model.timing->getHistogram();
+            int first = -1, last = -1;
+            juce::uint32 tallest = 0;
+            for (int i = 0; i < PaintHistogram::numBuckets; ++i)
+            {
+                auto count = histogram.getCount (i);
+                if (count == 0)
+                    continue;
+
+                if (first < 0)
+                    first = i;
+                last = i;
+                tallest = juce::jmax (tallest, count);
+            }
+
+            if (first < 0)
+                return;
+
+            auto p95Bucket = PaintHistogram::bucketFor ((double) model.timingP95.getValue());
+            auto numBars = last - first + 1;
+            auto barWidth = juce::jmax (1.0f, (float) bounds.getWidth() / (float) numBars);
+            for (int i = first; i <= last; ++i)
+            {
+                auto barHeight = (float) bounds.getHeight() * (float) histogram.getCount (i) / (float) tallest;
+                auto x = (float) bounds.getX() + (float) (i - first) * barWidth;
+                if (x >= (float) bounds.getRight())
+                    break;
+
+                g.setColour (i > p95Bucket ? colors::propertyValueWarn : colors::propertyName);
+                g.fillRect (juce::Rectangle<float> (x, (float) bounds.getBottom() - barHeight, juce::jmax (1.0f, barWidth - 1.0f), barHeight));
+            }
+        }
+
         static juce::String timingWithUnits (double value)
         {
             double ms = value * 1000;
@@ -11,13 +11,11 @@ namespace melatonin
             "paddingRight",
             "paddingTop",
             "paddingBottom",
-            "timing1",
-            "timing2",
-            "timing3",
-            "timingMax" };
+            "melatoninTiming" };
 
         explicit Properties (ComponentModel& _model) : model (_model)
         {
+            createRows();
             reset();
 
             addAndMakeVisible (&panel);
@@ -43,96 +41,248 @@ namespace melatonin
         }
 
     private:
+        // a text row that can be pointed at another Value without being recreated
+        class TextRow : public juce::TextPropertyComponent
+        {
+        public:
+            TextRow (const juce::Value& v, const juce::String& name, int maxChars, bool editable)
+                : juce::TextPropertyComponent (name, maxChars, false, editable)
+            {
+                bind (v);
+            }
+
+            void bind (const juce::Value& v)
+            {
+                getValue().referTo (v);
+            }
+
+            // for values that only exist for display, edits go nowhere
+            void showDetached (const juce::var& v)
+            {
+                getValue().referTo (detached);
+                detached = v;
+            }
+
+        private:
+            juce::Value detached;
+        };
+
+        // BooleanPropertyComponent only takes its Value in the constructor
+        class BoolRow : public juce::BooleanPropertyComponent, private juce::Value::Listener
+        {
+        public:
+            BoolRow (const juce::Value& v, const juce::String& name) : juce::BooleanPropertyComponent (name, "", "")
+            {
+                value.addListener (this);
+                bind (v);
+            }
+
+            ~BoolRow() override
+            {
+                value.removeListener (this);
+            }
+
+            void bind (const juce::Value& v)
+            {
+                value.referTo (v);
+                refresh();
+            }
+
+            void unbind()
+            {
+                bind (detached);
+            }
+
+            void setState (bool newState) override { value = newState; }
+            bool getState() const override { return value.getValue(); }
+
+        private:
+            juce::Value value, detached;
+
+            void valueChanged (juce::Value&) override { refresh(); }
+        };
+
+        // sections only pad between their own rows, this leads every section
+        // but the first so the gaps between sections match the ones inside them
+        class Gap : public juce::PropertyComponent
+        {
+        public:
+            Gap() : juce::PropertyComponent ({}, 0) {}
+            void paint (juce::Graphics&) override {}
+            void refresh() override {}
+        };
+
+        // one slot per model property, showing whichever section fits the value
+        struct UserRow
+        {
+            TextRow* text = nullptr;
+            BoolRow* toggle = nullptr;
+        };
+
         ComponentModel& model;
         juce::PropertyPanel panel { "Properties" };
 
         int padding = 3;
 
-        void componentModelChanged (ComponentModel&) override
+        // every row is created once and rebound on selection, rows that don't apply
+        // to the selected component are hidden by closing their section
+        std::vector<UserRow> userRows;
+        bool showingButtonRows = true;
+
+        // sections in order: class and name, two per user row (text, toggle), button, flags
+        static int textSection (size_t slot) { return 1 + 2 * (int) slot; }
+        static int toggleSection (size_t slot) { return 2 + 2 * (int) slot; }
+        [[nodiscard]] int buttonSection() const { return 1 + 2 * (int) userRows.size(); }
+
+        void componentModelChanged (ComponentModel&, int changes) override
         {
-            updateProperties();
+            // moves and resizes don't touch anything we display
+            if (changes & (ComponentModel::selectionChanged | ComponentModel::propertiesChanged))
+                updateProperties();
         }
 
-        void updateProperties()
+        void addSection (const juce::String& name, juce::Array<juce::PropertyComponent*> rows, bool leadingGap, bool open = true, int index = -1)
         {
-            TRACE_COMPONENT();
-            panel.clear();
+            if (leadingGap)
+                rows.insert (0, new Gap());
 
-            if (!model.getSelectedComponent())
-                return;
-
-            auto props = createPropertyComponents();
-            for (auto* p : props)
+            for (auto* p : rows)
             {
                 p->setLookAndFeel (&getLookAndFeel());
             }
-            panel.addProperties (props, padding);
 
-            resized();
+            // sections need a name to be opened and closed, the look and feel gives them no header
+            panel.addSection (name, rows, open, index, padding);
         }
 
-        [[nodiscard]] juce::Array<juce::PropertyComponent*> createPropertyComponents() const
+        void createRows()
         {
             TRACE_COMPONENT();
 
             // we can't actually set these values from the front end, so disable them
-            auto hasCachedImage = new juce::BooleanPropertyComponent (model.hasCachedImageValue, "CachedToImage", "");
+            auto hasCachedImage = new BoolRow (model.hasCachedImageValue, "CachedToImage");
             hasCachedImage->setEnabled (false);
 
             // Always have class up top
-            juce::Array<juce::PropertyComponent*> props = {
-                new juce::TextPropertyComponent (model.typeValue, "Class", 200, false, false),
-                new juce::TextPropertyComponent (model.nameValue, "Name", 200, false, true),
-            };
+            addSection ("Component",
+                { new TextRow (model.typeValue, "Class", 200, false),
+                    new TextRow (model.nameValue, "Name", 200, true) },
+                false);
+
+            // model properties get sections in between, see ensureUserRows
+
+            // class specific properies
+            addSection ("Button",
+                { new BoolRow (model.isToggleable, "Is Toggleable"),
+                    new BoolRow (model.toggleState, "Toggle State"),
+                    new BoolRow (model.clickTogglesState, "Clicking Toggles State"),
+                    new TextRow (model.radioGroupId, "Radio Group ID", 5, true) },
+                true);
+
+            // then the rest of the component flags
+            addSection ("Flags",
+                { new TextRow (model.lookAndFeelValue, "LookAndFeel", 200, false),
+                    new BoolRow (model.visibleValue, "Visible"),
+                    new BoolRow (model.enabledValue, "Enabled"),
+                    new TextRow (model.alphaValue, "Alpha", 5, true),
+                    new BoolRow (model.opaqueValue, "Opaque"),
+                    new TextRow (model.fontValue, "Font", 5, false),
+                    new BoolRow (model.wantsFocusValue, "Wants Keyboard Focus"),
+                    new BoolRow (model.accessibilityHandledValue, "Accessibility"),
+                    hasCachedImage,
+                    new BoolRow (model.interceptsMouseValue, "Intercepts Mouse"),
+                    new BoolRow (model.childrenInterceptsMouseValue, "Children Intercepts") },
+                true);
+        }
+
+        // only allocates when a component has more properties than we've seen so far
+        void ensureUserRows (size_t numNeeded)
+        {
+            while (userRows.size() < numNeeded)
+            {
+                auto slot = userRows.size();
+                UserRow row { new TextRow ({}, {}, 200, true), new BoolRow ({}, {}) };
+                addSection ("Property", { row.text }, true, false, textSection (slot));
+                addSection ("Property", { row.toggle }, true, false, toggleSection (slot));
+                userRows.push_back (row);
+            }
+        }
+
+        static void setRowName (juce::PropertyComponent& row, const juce::String& name)
+        {
+            if (row.getName() != name)
+            {
+                row.setName (name);
+                row.repaint();
+            }
+        }
 
-            // Then prioritize model properties
+        void updateProperties()
+        {
+            TRACE_COMPONENT();
+
+            auto* component = model.getSelectedComponent();
+            panel.setVisible (component != nullptr);
+            if (component == nullptr)
+                return;
+
+            ensureUserRows (model.namedProperties.size());
+
+            size_t numUsed = 0;
             for (auto& nv : model.namedProperties)
             {
-                if (nv.value.getValue().isBool())
-                    props.add (new juce::BooleanPropertyComponent (nv.value, nv.name, ""));
+                auto& row = userRows[numUsed];
+                auto isToggle = nv.value.getValue().isBool();
+
+                if (isToggle)
+                {
+                    row.toggle->bind (nv.value);
+                    setRowName (*row.toggle, nv.name);
+                }
                 else if (nv.value.getValue().isInt64() && nv.name.getLastCharacters (2) == "At")
                 {
-                    auto datetime = juce::Value (juce::Time (nv.value.getValue()).toString (false, true, true, true));
-                    auto datetimeProp = new juce::TextPropertyComponent (datetime, nv.name, 200, false, false);
-                    datetimeProp->setEnabled (false);
-                    props.add (datetimeProp);
+                    row.text->showDetached (juce::Time (nv.value.getValue()).toString (false, true, true, true));
+                    row.text->setEnabled (false);
+                    row.text->getProperties().set ("isUserProperty", false);
+                    setRowName (*row.text, nv.name);
                 }
                 else if (!propertiesToIgnore.contains (nv.name))
                 {
-                    const auto value = nv.value.getValue().isObject()
-                                           ? juce::Value (nv.value.getValue().toString())
-                                           : nv.value;
-                    auto customProperty = new juce::TextPropertyComponent (value, nv.name, 200, false);
-                    customProperty->getProperties().set ("isUserProperty", true);
-                    props.add (customProperty);
+                    if (nv.value.getValue().isObject())
+                        row.text->showDetached (nv.value.getValue().toString());
+                    else
+                        row.text->bind (nv.value);
+
+                    row.text->setEnabled (true);
+                    row.text->getProperties().set ("isUserProperty", true);
+                    setRowName (*row.text, nv.name);
                 }
+                else
+                    continue;
+
+                panel.setSectionOpen (textSection (numUsed), !isToggle);
+                panel.setSectionOpen (toggleSection (numUsed), isToggle);
+                ++numUsed;
             }
 
-            // add class specific properies
-            if (dynamic_cast<juce::Button*> (model.getSelectedComponent()))
+            // close the leftovers, and let go of the last component's values
+            for (auto i = numUsed; i < userRows.size(); ++i)
             {
-                props.addArray (juce::Array<juce::PropertyComponent*> {
-                    new juce::BooleanPropertyComponent (model.isToggleable, "Is Toggleable", ""),
-                    new juce::BooleanPropertyComponent (model.toggleState, "Toggle State", ""),
-                    new juce::BooleanPropertyComponent (model.clickTogglesState, "Clicking Toggles State", ""),
-                    new juce::TextPropertyComponent (model.radioGroupId, "Radio Group ID", 5, false) });
+                userRows[i].text->showDetached ({});
+                userRows[i].toggle->unbind();
+                panel.setSectionOpen (textSection (i), false);
+                panel.setSectionOpen (toggleSection (i), false);
             }
 
-            // then the rest of the component flags
-            props.addArray (juce::Array<juce::PropertyComponent*> {
-                new juce::TextPropertyComponent (model.lookAndFeelValue, "LookAndFeel", 200, false, false),
-                new juce::BooleanPropertyComponent (model.visibleValue, "Visible", ""),
-                new juce::BooleanPropertyComponent (model.enabledValue, "Enabled", ""),
-                new juce::TextPropertyComponent (model.alphaValue, "Alpha", 5, false),
-                new juce::BooleanPropertyComponent (model.opaqueValue, "Opaque", ""),
-                new juce::TextPropertyComponent (model.fontValue, "Font", 5, false, false),
-                new juce::BooleanPropertyComponent (model.wantsFocusValue, "Wants Keyboard Focus", ""),
-                new juce::BooleanPropertyComponent (model.accessibilityHandledValue, "Accessibility", ""),
-                hasCachedImage,
-                new juce::BooleanPropertyComponent (model.interceptsMouseValue, "Intercepts Mouse", ""),
-                new juce::BooleanPropertyComponent (model.childrenInterceptsMouseValue, "Children Intercepts", "") });
-
-            return props;
+            auto isButton = dynamic_cast<juce::Button*> (component) != nullptr;
+            if (isButton != showingButtonRows)
+            {
+                showingButtonRows = isButton;
+                panel.setSectionOpen (buttonSection(), isButton);
+            }
+
+            panel.refreshAll();
+            resized();
         }
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Properties)
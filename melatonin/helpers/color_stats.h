@@ -0,0 +1,269 @@
+#pragma once
+#include "juce_gui_basics/juce_gui_basics.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MELATONIN_COLOR_STATS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define MELATONIN_COLOR_STATS_NEON 1
+#endif
+
+namespace melatonin
+{
+    // What's in a region of pixels, for the eyedropper's region mode
+    // Colours are as composited (premultiplied), which is what ends up on screen over black
+    struct RegionColorStats
+    {
+        int numPixels = 0;
+        juce::Colour mean, median, dominant;
+
+        // 8 bit luma (Rec. 709 weights, not linearised)
+        std::array<juce::uint32, 256> lumaHistogram {};
+
+        // the region split in two by luma (Otsu), background is the larger cluster
+        juce::Colour foreground, background;
+        float contrastRatio = 1.0f; // WCAG 2, from 1 to 21
+
+        // WCAG 2 relative luminance
+        static float relativeLuminance (juce::Colour c)
+        {
+            auto linear = [] (float v) { return v <= 0.04045f ? v / 12.92f : std::pow ((v + 0.055f) / 1.055f, 2.4f); };
+            return 0.2126f * linear (c.getFloatRed()) + 0.7152f * linear (c.getFloatGreen()) + 0.0722f * linear (c.getFloatBlue());
+        }
+
+        static float contrastBetween (juce::Colour a, juce::Colour b)
+        {
+            auto la = relativeLuminance (a);
+            auto lb = relativeLuminance (b);
+            return (juce::jmax (la, lb) + 0.05f) / (juce::jmin (la, lb) + 0.05f);
+        }
+    };
+
+    // Owns its scratch space, so analysing on every mouse move doesn't allocate
+    //
+    // Channel sums and luma are computed 4 pixels at a time (SSE2 or NEON, scalar otherwise),
+    // the histograms behind median, dominant colour and the clusters are filled in the same pass
+    class RegionColorAnalyser
+    {
+    public:
+        const RegionColorStats& analyse (const juce::Image& image, juce::Rectangle<int> area)
+        {
+            TRACE_COMPONENT();
+
+            stats = {};
+            channelHistograms.fill (0);
+            std::fill (dominantBins.begin(), dominantBins.end(), 0u);
+            for (auto& s : sumsByLuma)
+                s.fill (0);
+
+            area = area.getIntersection (image.getBounds());
+            if (area.isEmpty())
+                return stats;
+
+            // the backbuffer and loupe are already ARGB, anything else gets converted once
+            auto argb = image.getFormat() == juce::Image::ARGB ? image : image.convertedToFormat (juce::Image::ARGB);
+            juce::Image::BitmapData data (argb, area.getX(), area.getY(), area.getWidth(), area.getHeight(), juce::Image::BitmapData::readOnly);
+
+            auto width = (size_t) area.getWidth();
+            if (lumaRow.size() < width)
+                lumaRow.resize (width);
+
+            std::array<juce::uint64, 3> sums {};
+            for (int y = 0; y < area.getHeight(); ++y)
+            {
+                auto* row = reinterpret_cast<const juce::uint32*> (data.getLinePointer (y));
+                sumRow (row, width, lumaRow.data(), sums);
+                countRow (row, width, lumaRow.data());
+            }
+
+            auto n = (juce::uint64) area.getWidth() * (juce::uint64) area.getHeight();
+            stats.numPixels = (int) n;
+            stats.mean = colourFromSums (sums[0], sums[1], sums[2], n);
+            stats.median = juce::Colour (medianOf (channelHistograms[0], n), medianOf (channelHistograms[1], n), medianOf (channelHistograms[2], n));
+
+            auto mostCommon = (size_t) std::distance (dominantBins.begin(), std::max_element (dominantBins.begin(), dominantBins.end()));
+            stats.dominant = juce::Colour ((juce::uint8) (((mostCommon >> 8) & 15) * 17), (juce::uint8) (((mostCommon >> 4) & 15) * 17), (juce::uint8) ((mostCommon & 15) * 17));
+
+            findClusters (n);
+            return stats;
+        }
+
+        [[nodiscard]] const RegionColorStats& getStats() const noexcept { return stats; }
+
+    private:
+        RegionColorStats stats;
+        std::array<std::array<juce::uint32, 256>, 3> channelHistograms {};
+        std::vector<juce::uint32> dominantBins = std::vector<juce::uint32> (4096); // 4 bits per channel
+        std::array<std::array<juce::uint64, 3>, 256> sumsByLuma {};
+        std::vector<juce::uint8> lumaRow;
+
+        // PixelARGB is stored as a native uint32 with blue in the low byte
+        static constexpr juce::uint32 rLuma = 54, gLuma = 183, bLuma = 19; // sums to 256
+
+        static void sumRow (const juce::uint32* pixels, size_t width, juce::uint8* luma, std::array<juce::uint64, 3>& sums)
+        {
+            size_t i = 0;
+
+#if MELATONIN_COLOR_STATS_SSE2
+            // lanes hold at most 255 * (width / 4), so a row can't overflow them
+            auto mask = _mm_set1_epi32 (0xff);
+            auto sumR = _mm_setzero_si128(), sumG = _mm_setzero_si128(), sumB = _mm_setzero_si128();
+            for (; i + 4 <= width; i += 4)
+            {
+                auto px = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (pixels + i));
+                auto r = _mm_and_si128 (_mm_srli_epi32 (px, 16), mask);
+                auto g = _mm_and_si128 (_mm_srli_epi32 (px, 8), mask);
+                auto b = _mm_and_si128 (px, mask);
+                sumR = _mm_add_epi32 (sumR, r);
+                sumG = _mm_add_epi32 (sumG, g);
+                sumB = _mm_add_epi32 (sumB, b);
+
+                // channels fit in the low 16 bits of each lane, so madd is a 32 bit multiply
+                auto y = _mm_add_epi32 (_mm_add_epi32 (_mm_madd_epi16 (r, _mm_set1_epi32 ((int) rLuma)), _mm_madd_epi16 (g, _mm_set1_epi32 ((int) gLuma))), _mm_madd_epi16 (b, _mm_set1_epi32 ((int) bLuma)));
+                y = _mm_srli_epi32 (y, 8);
+                y = _mm_packus_epi16 (_mm_packs_epi32 (y, y), y);
+                auto packed = (juce::uint32) _mm_cvtsi128_si32 (y);
+                std::memcpy (luma + i, &packed, 4);
+            }
+
+            alignas (16) juce::uint32 lanes[4];
+            _mm_store_si128 (reinterpret_cast<__m128i*> (lanes), sumR);
+            sums[0] += (juce::uint64) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_store_si128 (reinterpret_cast<__m128i*> (lanes), sumG);
+            sums[1] += (juce::uint64) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_store_si128 (reinterpret_cast<__m128i*> (lanes), sumB);
+            sums[2] += (juce::uint64) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif MELATONIN_COLOR_STATS_NEON
+            auto mask = vdupq_n_u32 (0xff);
+            auto sumR = vdupq_n_u32 (0), sumG = vdupq_n_u32 (0), sumB = vdupq_n_u32 (0);
+            for (; i + 4 <= width; i += 4)
+            {
+                auto px = vld1q_u32 (pixels + i);
+                auto r = vandq_u32 (vshrq_n_u32 (px, 16), mask);
+                auto g = vandq_u32 (vshrq_n_u32 (px, 8), mask);
+                auto b = vandq_u32 (px, mask);
+                sumR = vaddq_u32 (sumR, r);
+                sumG = vaddq_u32 (sumG, g);
+                sumB = vaddq_u32 (sumB, b);
+
+                auto y = vshrq_n_u32 (vmlaq_n_u32 (vmlaq_n_u32 (vmulq_n_u32 (r, rLuma), g, gLuma), b, bLuma), 8);
+                auto narrowed = vmovn_u16 (vcombine_u16 (vmovn_u32 (y), vdup_n_u16 (0)));
+                auto packed = vget_lane_u32 (vreinterpret_u32_u8 (narrowed), 0);
+                std::memcpy (luma + i, &packed, 4);
+            }
+
+            sums[0] += vgetq_lane_u32 (sumR, 0) + (juce::uint64) vgetq_lane_u32 (sumR, 1) + vgetq_lane_u32 (sumR, 2) + vgetq_lane_u32 (sumR, 3);
+            sums[1] += vgetq_lane_u32 (sumG, 0) + (juce::uint64) vgetq_lane_u32 (sumG, 1) + vgetq_lane_u32 (sumG, 2) + vgetq_lane_u32 (sumG, 3);
+            sums[2] += vgetq_lane_u32 (sumB, 0) + (juce::uint64) vgetq_lane_u32 (sumB, 1) + vgetq_lane_u32 (sumB, 2) + vgetq_lane_u32 (sumB, 3);
+#endif
+
+            for (; i < width; ++i)
+            {
+                auto px = pixels[i];
+                auto r = (px >> 16) & 0xff, g = (px >> 8) & 0xff, b = px & 0xff;
+                sums[0] += r;
+                sums[1] += g;
+                sums[2] += b;
+                luma[i] = (juce::uint8) ((r * rLuma + g * gLuma + b * bLuma) >> 8);
+            }
+        }
+
+        // histograms are scatter writes, there's nothing to vectorise here
+        void countRow (const juce::uint32* pixels, size_t width, const juce::uint8* luma)
+        {
+            for (size_t i = 0; i < width; ++i)
+            {
+                auto px = pixels[i];
+                auto r = (px >> 16) & 0xff, g = (px >> 8) & 0xff, b = px & 0xff;
+                ++channelHistograms[0][r];
+                ++channelHistograms[1][g];
+                ++channelHistograms[2][b];
+                ++dominantBins[((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4)];
+
+                auto& byLuma = sumsByLuma[luma[i]];
+                byLuma[0] += r;
+                byLuma[1] += g;
+                byLuma[2] += b;
+                ++stats.lumaHistogram[luma[i]];
+            }
+        }
+
+        // Otsu's threshold on the luma histogram, then the mean colour either side of it
+        void findClusters (juce::uint64 n)
+        {
+            double total = 0;
+            for (size_t i = 0; i < 256; ++i)
+                total += (double) i * stats.lumaHistogram[i];
+
+            double bestVariance = -1, sumBelow = 0;
+            juce::uint64 countBelow = 0;
+            size_t threshold = 0;
+            for (size_t t = 0; t < 256; ++t)
+            {
+                countBelow += stats.lumaHistogram[t];
+                sumBelow += (double) t * stats.lumaHistogram[t];
+                auto countAbove = n - countBelow;
+                if (countBelow == 0 || countAbove == 0)
+                    continue;
+
+                auto meanDifference = sumBelow / (double) countBelow - (total - sumBelow) / (double) countAbove;
+                auto variance = (double) countBelow * (double) countAbove * meanDifference * meanDifference;
+                if (variance > bestVariance)
+                {
+                    bestVariance = variance;
+                    threshold = t;
+                }
+            }
+
+            // a flat region has nothing above the threshold
+            if (bestVariance < 0)
+            {
+                stats.foreground = stats.background = stats.mean;
+                stats.contrastRatio = 1.0f;
+                return;
+            }
+
+            std::array<juce::uint64, 3> dark {}, light {};
+            juce::uint64 numDark = 0, numLight = 0;
+            for (size_t i = 0; i < 256; ++i)
+            {
+                auto& sums = i <= threshold ? dark : light;
+                for (size_t c = 0; c < 3; ++c)
+                    sums[c] += sumsByLuma[i][c];
+                (i <= threshold ? numDark : numLight) += stats.lumaHistogram[i];
+            }
+
+            auto darkColour = colourFromSums (dark[0], dark[1], dark[2], numDark);
+            auto lightColour = colourFromSums (light[0], light[1], light[2], numLight);
+            stats.background = numDark >= numLight ? darkColour : lightColour;
+            stats.foreground = numDark >= numLight ? lightColour : darkColour;
+            stats.contrastRatio = RegionColorStats::contrastBetween (stats.foreground, stats.background);
+        }
+
+        static juce::Colour colourFromSums (juce::uint64 r, juce::uint64 g, juce::uint64 b, juce::uint64 n)
+        {
+            if (n == 0)
+                return juce::Colours::transparentBlack;
+
+            return juce::Colour ((juce::uint8) ((r + n / 2) / n), (juce::uint8) ((g + n / 2) / n), (juce::uint8) ((b + n / 2) / n));
+        }
+
+        static juce::uint8 medianOf (const std::array<juce::uint32, 256>& histogram, juce::uint64 n)
+        {
+            juce::uint64 cumulative = 0;
+            for (size_t i = 0; i < 256; ++i)
+            {
+                cumulative += histogram[i];
+                if (cumulative * 2 >= n)
+                    return (juce::uint8) i;
+            }
+            return 255;
+        }
+    };
+}
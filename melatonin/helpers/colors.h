@@ -47,6 +47,7 @@ namespace melatonin::colors
     const juce::Colour overlayLabelBackground = juce::Colour::fromRGB (20, 157, 249);
     const juce::Colour boxModelBoundingBox = juce::Colour::fromRGB (66, 157, 226);
     const juce::Colour overlayDistanceToHovered = juce::Colour::fromRGB (212, 86, 63);
+    const juce::Colour overlaySnapGuide = juce::Colour::fromRGB (255, 71, 181);
 
     const juce::Colour checkerDark = juce::Colour::fromRGB (51, 51, 51);
     const juce::Colour checkerLight = juce::Colour::fromRGB (104, 104, 104);
@@ -3,6 +3,9 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 using namespace juce;
 #include <cctype>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
 #include <juce_gui_basics/detail/juce_ScalingHelpers.h>
 #include <juce_gui_basics/detail/juce_ComponentHelpers.h>
 using namespace melatonin;
@@ -24,22 +27,42 @@ namespace melatonin
         return (status == 0) ? res.get() : name;
     }
 
-    template <class T>
-    static inline juce::String type (const T& t)
+    static inline juce::String readableTypeName (const std::type_info& info)
     {
-        return demangle (typeid (t).name());
+        return demangle (info.name());
     }
 }
 #else
 namespace melatonin
 {
+    static inline juce::String readableTypeName (const std::type_info& info)
+    {
+        return juce::String (info.name()).replace ("class ", "").replace ("struct ", "");
+    }
+}
+#endif
+namespace melatonin
+{
+    // each class is demangled once per process, after that it's a lookup and a ref count bump
+    inline juce::String type (const std::type_info& info)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::type_index, juce::String> names;
+
+        const std::lock_guard<std::mutex> lock (mutex);
+        auto found = names.find (info);
+        if (found != names.end())
+            return found->second;
+
+        return names.emplace (info, readableTypeName (info)).first->second;
+    }
+
     template <class T>
     static inline juce::String type (const T& t)
     {
-        return juce::String (typeid (t).name()).replace ("class ", "").replace ("struct ", "");
+        return type (typeid (t));
     }
 }
-#endif
 namespace melatonin
 {
     // do our best to derive a useful UI string from a component
@@ -74,6 +97,41 @@ namespace melatonin
         }
     }
 
+    // the overlay and the eyedropper's repaint tracker live inside the root, but aren't part of the app
+    static inline bool isInspectorOverlay (juce::Component* c)
+    {
+        return c->getName() == "Melatonin Overlay" || c->getName() == "Melatonin Repaint Tracker";
+    }
+
+    // A few JUCE component types need massaging to get their child components
+    template <typename Callback>
+    static inline void forEachChildToDisplay (juce::Component* c, Callback&& callback)
+    {
+        if (auto multiPanel = dynamic_cast<juce::MultiDocumentPanel*> (c))
+        {
+            if (auto tabs = multiPanel->getCurrentTabbedComponent())
+                callback (tabs);
+        }
+        else if (auto tabs = dynamic_cast<juce::TabbedComponent*> (c))
+        {
+            for (int i = 0; i < tabs->getNumTabs(); ++i)
+            {
+                // Components such as Labels can have a nullptr component child
+                // Rather than display empty placeholders in the tree view, we will hide them
+                if (auto content = tabs->getTabContentComponent (i))
+                    callback (content);
+            }
+        }
+        else
+        {
+            for (auto* child : c->getChildren())
+            {
+                if (!isInspectorOverlay (child))
+                    callback (child);
+            }
+        }
+    }
+
     // do our best to derive a useful UI string from a component
     static inline juce::String componentFontValue (juce::Component* c)
     {
@@ -0,0 +1,301 @@
+#pragma once
+#include "component_helpers.h"
+#include <unordered_map>
+#include <vector>
+
+namespace melatonin
+{
+    // Case-insensitive substring search over component names, demangled types,
+    // component IDs and accessibility titles.
+    //
+    // Queries of 3+ characters only verify the entries listed under their rarest trigram,
+    // shorter ones scan the lowercase entries. The index is built on first use and then
+    // kept current through ComponentListener callbacks, so typing never walks the hierarchy.
+    //
+    // Those listeners also keep the number of components. Counting can start on its own,
+    // without paying for entries and trigrams until something is searched for.
+    class ComponentSearchIndex : private juce::ComponentListener
+    {
+    public:
+        ComponentSearchIndex() = default;
+
+        ~ComponentSearchIndex() override
+        {
+            clear();
+        }
+
+        void setRoot (juce::Component* newRoot)
+        {
+            if (newRoot == root)
+                return;
+
+            clear();
+            root = newRoot;
+        }
+
+        // listens to every component under the root, without indexing anything yet
+        void startCounting()
+        {
+            if (counting || root == nullptr)
+                return;
+
+            counting = true;
+            add (root);
+            numComponentsMightHaveChanged();
+        }
+
+        // the first search does this
+        void ensureBuilt()
+        {
+            startCounting();
+            if (built || root == nullptr)
+                return;
+
+            built = true;
+            for (auto& [component, id] : ids)
+                id = addEntry (*component);
+        }
+
+        [[nodiscard]] bool isCounting() const noexcept { return counting; }
+
+        // called with the new count whenever components are added to or removed from the hierarchy
+        std::function<void (int)> onNumComponentsChanged;
+
+        std::vector<juce::Component*> search (const juce::String& query)
+        {
+            TRACE_COMPONENT();
+
+            ensureBuilt();
+
+            std::vector<juce::Component*> results;
+            auto needle = query.toLowerCase();
+            if (needle.isEmpty())
+                return results;
+
+            // an entry can be listed under a trigram more than once
+            ++queryStamp;
+            auto verify = [&] (int id) {
+                auto& entry = entries[(size_t) id];
+                if (entry.component == nullptr || entry.stamp == queryStamp)
+                    return;
+
+                entry.stamp = queryStamp;
+                if (entry.text.contains (needle))
+                    results.push_back (entry.component);
+            };
+
+            if (needle.length() < 3)
+            {
+                for (int id = 0; id < (int) entries.size(); ++id)
+                    verify (id);
+                return results;
+            }
+
+            const std::vector<int>* candidates = nullptr;
+            forEachTrigram (needle, [&] (Trigram trigram) {
+                auto found = postings.find (trigram);
+                auto* list = found == postings.end() ? &noCandidates : &found->second;
+                if (candidates == nullptr || list->size() < candidates->size())
+                    candidates = list;
+            });
+
+            for (auto id : *candidates)
+                verify (id);
+
+            return results;
+        }
+
+        // 0 until counting has started
+        [[nodiscard]] int getNumComponents() const noexcept { return (int) ids.size(); }
+
+    private:
+        using Trigram = juce::uint64;
+
+        struct Entry
+        {
+            juce::Component* component = nullptr; // cleared in componentBeingDeleted
+            juce::String text;
+            juce::uint32 stamp = 0;
+        };
+
+        juce::Component* root = nullptr;
+        bool counting = false;
+        bool built = false;
+
+        std::vector<Entry> entries;
+        std::vector<int> freeIds;
+        std::unordered_map<juce::Component*, int> ids; // -1 until the index is built
+
+        // removed or renamed entries stay listed until the next compaction,
+        // queries verify every candidate anyway
+        std::unordered_map<Trigram, std::vector<int>> postings;
+        std::vector<int> noCandidates;
+        int numStaleEntries = 0;
+        juce::uint32 queryStamp = 0;
+        int lastNumComponents = 0;
+
+        void numComponentsMightHaveChanged()
+        {
+            if (getNumComponents() == lastNumComponents)
+                return;
+
+            lastNumComponents = getNumComponents();
+            if (onNumComponentsChanged)
+                onNumComponentsChanged (lastNumComponents);
+        }
+
+        void clear()
+        {
+            for (auto& [component, id] : ids)
+                component->removeComponentListener (this);
+
+            entries.clear();
+            freeIds.clear();
+            ids.clear();
+            postings.clear();
+            numStaleEntries = 0;
+            lastNumComponents = 0;
+            counting = false;
+            built = false;
+        }
+
+        static juce::String textFor (juce::Component& c)
+        {
+            juce::String text;
+            text << c.getName() << '\n' << type (c) << '\n' << c.getComponentID() << '\n' << c.getTitle();
+            return text.toLowerCase();
+        }
+
+        // trigrams never span the separators between fields
+        template <typename Callback>
+        static void forEachTrigram (const juce::String& text, Callback&& callback)
+        {
+            juce::juce_wchar a = 0, b = 0;
+            int run = 0;
+            for (auto p = text.getCharPointer(); !p.isEmpty();)
+            {
+                auto c = p.getAndAdvance();
+                if (c == '\n')
+                {
+                    run = 0;
+                    continue;
+                }
+
+                if (++run >= 3)
+                    callback (((Trigram) a << 42) | ((Trigram) b << 21) | (Trigram) c);
+
+                a = b;
+                b = c;
+            }
+        }
+
+        void addPostings (int id)
+        {
+            forEachTrigram (entries[(size_t) id].text, [&] (Trigram trigram) { postings[trigram].push_back (id); });
+        }
+
+        int addEntry (juce::Component& c)
+        {
+            int id;
+            if (!freeIds.empty())
+            {
+                id = freeIds.back();
+                freeIds.pop_back();
+            }
+            else
+            {
+                id = (int) entries.size();
+                entries.emplace_back();
+            }
+
+            entries[(size_t) id] = { &c, textFor (c), 0 };
+            addPostings (id);
+            return id;
+        }
+
+        // listens to c and its descendants, an already tracked component's children are
+        // already tracked (its listener picks up new ones), so that subtree is skipped
+        void add (juce::Component* c)
+        {
+            if (ids.count (c) != 0)
+                return;
+
+            ids[c] = built ? addEntry (*c) : -1;
+            c->addComponentListener (this);
+
+            forEachChildToDisplay (c, [this] (juce::Component* child) { add (child); });
+        }
+
+        void remove (juce::Component* c)
+        {
+            auto found = ids.find (c);
+            if (found == ids.end())
+                return;
+
+            auto id = found->second;
+            ids.erase (found);
+            c->removeComponentListener (this);
+
+            forEachChildToDisplay (c, [this] (juce::Component* child) { remove (child); });
+
+            if (id < 0)
+                return;
+
+            entries[(size_t) id] = {};
+            freeIds.push_back (id);
+            ++numStaleEntries;
+            compactIfNeeded();
+        }
+
+        void compactIfNeeded()
+        {
+            if (numStaleEntries < 64 || numStaleEntries < (int) ids.size() / 2)
+                return;
+
+            postings.clear();
+            for (auto& [component, id] : ids)
+                addPostings (id);
+
+            numStaleEntries = 0;
+        }
+
+        void componentChildrenChanged (juce::Component& c) override
+        {
+            // removed children are handled by componentParentHierarchyChanged
+            forEachChildToDisplay (&c, [this] (juce::Component* child) { add (child); });
+            numComponentsMightHaveChanged();
+        }
+
+        void componentParentHierarchyChanged (juce::Component& c) override
+        {
+            if (&c != root && root != nullptr && !root->isParentOf (&c))
+            {
+                remove (&c);
+                numComponentsMightHaveChanged();
+            }
+        }
+
+        void componentNameChanged (juce::Component& c) override
+        {
+            auto found = ids.find (&c);
+            if (found == ids.end() || found->second < 0)
+                return;
+
+            entries[(size_t) found->second].text = textFor (c);
+            addPostings (found->second);
+            ++numStaleEntries;
+            compactIfNeeded();
+        }
+
+        void componentBeingDeleted (juce::Component& c) override
+        {
+            if (&c == root)
+                setRoot (nullptr);
+            else
+                remove (&c);
+            numComponentsMightHaveChanged();
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComponentSearchIndex)
+    };
+}
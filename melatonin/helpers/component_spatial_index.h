@@ -0,0 +1,360 @@
+#pragma once
+#include "component_helpers.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace melatonin
+{
+    // Uniform grid over the on-screen bounds of every component below the root, in root coordinates
+    //
+    // Bounds are clipped by their ancestors (like hit testing and painting), so a point query
+    // only has to look at the components registered in one cell. Like ComponentSearchIndex,
+    // it's built on first use and then kept current through ComponentListener callbacks,
+    // until it's released (the inspector does that once a drag is over).
+    // Components covering a large part of the root skip the grid and are always checked.
+    class ComponentSpatialIndex : private juce::ComponentListener
+    {
+    public:
+        static constexpr int cellSize = 64;
+
+        ComponentSpatialIndex() = default;
+
+        ~ComponentSpatialIndex() override
+        {
+            clear();
+        }
+
+        void setRoot (juce::Component* newRoot)
+        {
+            clear();
+            root = newRoot;
+        }
+
+        // Same contract as getComponentAtExclude: the front-most visible component under a point
+        // (relative to parent) that is parent or one of its descendants. exclude and its children are skipped.
+        juce::Component* getComponentAt (juce::Component* parent, juce::Point<float> position, juce::Component* exclude = nullptr)
+        {
+            TRACE_COMPONENT();
+
+            ensureBuilt();
+            if (parent == nullptr || root == nullptr || ids.count (parent) == 0)
+                return nullptr;
+
+            auto point = root->getLocalPoint (parent, position);
+            auto pixel = point.toInt();
+            juce::Component* best = nullptr;
+
+            forEachCandidate (juce::Rectangle<int> (pixel.x, pixel.y, 1, 1), [&] (Entry& entry) {
+                auto* c = entry.component;
+                if (!entry.showing || !entry.bounds.contains (pixel))
+                    return;
+
+                if (c != parent && !parent->isParentOf (c))
+                    return;
+
+                if (exclude != nullptr && (c == exclude || exclude->isParentOf (c)))
+                    return;
+
+                auto local = c->getLocalPoint (root, point).roundToInt();
+                if (!c->hitTest (local.x, local.y))
+                    return;
+
+                if (best == nullptr || isInFrontOf (c, best))
+                    best = c;
+            });
+
+            return best;
+        }
+
+        [[nodiscard]] int getNumComponents() const noexcept { return (int) ids.size(); }
+
+        // stops listening to the hierarchy, the next query builds the index again
+        void release()
+        {
+            clear();
+        }
+
+    private:
+        using CellKey = juce::int64;
+
+        struct Entry
+        {
+            juce::Component* component = nullptr; // cleared in componentBeingDeleted
+            juce::Rectangle<int> bounds; // in root coordinates, clipped by ancestors
+            bool showing = false;
+            bool large = false;
+            juce::uint32 stamp = 0;
+        };
+
+        juce::Component* root = nullptr;
+        bool built = false;
+
+        std::vector<Entry> entries;
+        std::vector<int> freeIds;
+        std::unordered_map<juce::Component*, int> ids;
+        std::unordered_map<CellKey, std::vector<int>> cells;
+        std::vector<int> largeIds;
+        juce::uint32 queryStamp = 0;
+
+        // past this many cells it's cheaper to check a component on every query
+        static constexpr int maxCellsPerComponent = 256;
+
+        void ensureBuilt()
+        {
+            if (built || root == nullptr)
+                return;
+
+            built = true;
+            add (root);
+        }
+
+        void clear()
+        {
+            for (auto& [component, id] : ids)
+                component->removeComponentListener (this);
+
+            entries.clear();
+            freeIds.clear();
+            ids.clear();
+            cells.clear();
+            largeIds.clear();
+            built = false;
+        }
+
+        static CellKey keyFor (int cellX, int cellY)
+        {
+            return ((CellKey) cellX << 32) ^ (CellKey) (juce::uint32) cellY;
+        }
+
+        static juce::Rectangle<int> cellRange (juce::Rectangle<int> bounds)
+        {
+            auto floorDiv = [] (int v) { return v >= 0 ? v / cellSize : -((-v + cellSize - 1) / cellSize); };
+            auto x1 = floorDiv (bounds.getX()), y1 = floorDiv (bounds.getY());
+            auto x2 = floorDiv (bounds.getRight() - 1), y2 = floorDiv (bounds.getBottom() - 1);
+            return { x1, y1, x2 - x1 + 1, y2 - y1 + 1 };
+        }
+
+        template <typename Callback>
+        void forEachCandidate (juce::Rectangle<int> area, Callback&& callback)
+        {
+            // an entry is registered in every cell it overlaps
+            ++queryStamp;
+            auto visit = [&] (int id) {
+                auto& entry = entries[(size_t) id];
+                if (entry.component == nullptr || entry.stamp == queryStamp)
+                    return;
+
+                entry.stamp = queryStamp;
+                callback (entry);
+            };
+
+            for (auto id : largeIds)
+                visit (id);
+
+            auto range = cellRange (area);
+            for (int y = range.getY(); y < range.getBottom(); ++y)
+                for (int x = range.getX(); x < range.getRight(); ++x)
+                    if (auto found = cells.find (keyFor (x, y)); found != cells.end())
+                        for (auto id : found->second)
+                            visit (id);
+        }
+
+        // paint order: descendants are in front, otherwise compare the children of the common ancestor
+        static bool isInFrontOf (juce::Component* a, juce::Component* b)
+        {
+            if (b->isParentOf (a))
+                return true;
+            if (a->isParentOf (b))
+                return false;
+
+            for (auto* childOfCommon = a; childOfCommon != nullptr; childOfCommon = childOfCommon->getParentComponent())
+            {
+                auto* common = childOfCommon->getParentComponent();
+                if (common == nullptr || !common->isParentOf (b))
+                    continue;
+
+                auto* otherChild = b;
+                while (otherChild->getParentComponent() != common)
+                    otherChild = otherChild->getParentComponent();
+
+                return common->getIndexOfChildComponent (childOfCommon) > common->getIndexOfChildComponent (otherChild);
+            }
+
+            return false;
+        }
+
+        // unlike the tree, hit testing needs every child (tab bars included)
+        template <typename Callback>
+        static void forEachChild (juce::Component* c, Callback&& callback)
+        {
+            for (auto* child : c->getChildren())
+                if (!isInspectorOverlay (child))
+                    callback (child);
+        }
+
+        void unregisterCells (int id)
+        {
+            auto& entry = entries[(size_t) id];
+            if (entry.large)
+            {
+                largeIds.erase (std::remove (largeIds.begin(), largeIds.end(), id), largeIds.end());
+                entry.large = false;
+                return;
+            }
+
+            if (entry.bounds.isEmpty())
+                return;
+
+            auto range = cellRange (entry.bounds);
+            for (int y = range.getY(); y < range.getBottom(); ++y)
+                for (int x = range.getX(); x < range.getRight(); ++x)
+                    if (auto found = cells.find (keyFor (x, y)); found != cells.end())
+                    {
+                        auto& list = found->second;
+                        list.erase (std::remove (list.begin(), list.end(), id), list.end());
+                        if (list.empty())
+                            cells.erase (found);
+                    }
+        }
+
+        void registerCells (int id)
+        {
+            auto& entry = entries[(size_t) id];
+            if (entry.bounds.isEmpty())
+                return;
+
+            auto range = cellRange (entry.bounds);
+            if (range.getWidth() * range.getHeight() > maxCellsPerComponent)
+            {
+                entry.large = true;
+                largeIds.push_back (id);
+                return;
+            }
+
+            for (int y = range.getY(); y < range.getBottom(); ++y)
+                for (int x = range.getX(); x < range.getRight(); ++x)
+                    cells[keyFor (x, y)].push_back (id);
+        }
+
+        // recomputes bounds for c and its descendants, parents are always updated before children
+        void update (juce::Component* c)
+        {
+            auto found = ids.find (c);
+            if (found == ids.end())
+                return;
+
+            auto id = found->second;
+            unregisterCells (id);
+
+            auto& entry = entries[(size_t) id];
+            auto* parent = c == root ? nullptr : c->getParentComponent();
+            auto parentEntry = parent != nullptr ? ids.find (parent) : ids.end();
+
+            if (parentEntry == ids.end())
+            {
+                entry.bounds = c == root ? root->getLocalBounds() : juce::Rectangle<int>();
+                entry.showing = c->isVisible();
+            }
+            else
+            {
+                auto& parentState = entries[(size_t) parentEntry->second];
+                entry.bounds = root->getLocalArea (parent, c->getBoundsInParent()).getIntersection (parentState.bounds);
+                entry.showing = parentState.showing && c->isVisible();
+            }
+
+            registerCells (id);
+
+            forEachChild (c, [this] (juce::Component* child) { update (child); });
+        }
+
+        // indexes c and its descendants, an indexed component's children are already
+        // indexed (its listener picks up new ones), so that subtree is skipped
+        void add (juce::Component* c)
+        {
+            if (ids.count (c) != 0)
+                return;
+
+            addEntries (c);
+            update (c);
+        }
+
+        void addEntries (juce::Component* c)
+        {
+            if (ids.count (c) != 0)
+                return;
+
+            int id;
+            if (!freeIds.empty())
+            {
+                id = freeIds.back();
+                freeIds.pop_back();
+            }
+            else
+            {
+                id = (int) entries.size();
+                entries.emplace_back();
+            }
+
+            entries[(size_t) id] = { c, {}, false, false, 0 };
+            ids[c] = id;
+            c->addComponentListener (this);
+
+            forEachChild (c, [this] (juce::Component* child) { addEntries (child); });
+        }
+
+        void remove (juce::Component* c)
+        {
+            auto found = ids.find (c);
+            if (found == ids.end())
+                return;
+
+            auto id = found->second;
+            unregisterCells (id);
+            ids.erase (found);
+            entries[(size_t) id] = {};
+            freeIds.push_back (id);
+            c->removeComponentListener (this);
+
+            forEachChild (c, [this] (juce::Component* child) { remove (child); });
+        }
+
+        void componentMovedOrResized (juce::Component& c, bool, bool wasResized) override
+        {
+            // root coordinates don't change when the window moves
+            if (&c == root && !wasResized)
+                return;
+
+            update (&c);
+        }
+
+        void componentVisibilityChanged (juce::Component& c) override
+        {
+            update (&c);
+        }
+
+        void componentChildrenChanged (juce::Component& c) override
+        {
+            // removed children are handled by componentParentHierarchyChanged
+            forEachChild (&c, [this] (juce::Component* child) { add (child); });
+        }
+
+        void componentParentHierarchyChanged (juce::Component& c) override
+        {
+            if (&c != root && root != nullptr && !root->isParentOf (&c))
+                remove (&c);
+            else
+                update (&c); // moved to another parent under the root
+        }
+
+        void componentBeingDeleted (juce::Component& c) override
+        {
+            if (&c == root)
+                setRoot (nullptr);
+            else
+                remove (&c);
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComponentSpatialIndex)
+    };
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <array>
+#include <utility>
+
+namespace melatonin
+{
+    // Message thread time spent by the inspector itself, per subsystem
+    //
+    // Time is charged to the innermost subsystem (a snapshot taken during a model refresh
+    // only counts as a snapshot) and summed over one second windows. Each window's total, as a
+    // share of the message thread, is the average share of every frame the inspector took.
+    // Once that goes over the budget, expensive features check isOverBudget() and back off
+    // until the inspector is comfortably under budget again.
+    class InspectorCost
+    {
+    public:
+        enum Subsystem
+        {
+            overlayPaint,
+            mouseListener,
+            modelRefresh,
+            previewSnapshot,
+            numSubsystems
+        };
+
+        static constexpr juce::uint32 windowMs = 1000;
+
+        static InspectorCost& getInstance()
+        {
+            static InspectorCost instance;
+            return instance;
+        }
+
+        static const char* getName (int subsystem)
+        {
+            switch (subsystem)
+            {
+                case overlayPaint:
+                    return "Overlay paint";
+                case mouseListener:
+                    return "Mouse listener";
+                case modelRefresh:
+                    return "Model refresh";
+                case previewSnapshot:
+                    return "Preview snapshots";
+                default:
+                    return "";
+            }
+        }
+
+        // charges the time until it goes out of scope to a subsystem
+        class Scope
+        {
+        public:
+            explicit Scope (Subsystem s) : cost (getInstance()), previous (cost.enter (s)) {}
+            ~Scope() { cost.exit (previous); }
+
+        private:
+            InspectorCost& cost;
+            int previous;
+            JUCE_DECLARE_NON_COPYABLE (Scope)
+        };
+
+        // share of the message thread over the last complete window, 0.01 is 1% of every frame
+        double getShare (int subsystem)
+        {
+            update();
+            return shares[(size_t) subsystem];
+        }
+
+        double getTotalShare()
+        {
+            update();
+            double total = 0;
+            for (auto share : shares)
+                total += share;
+            return total;
+        }
+
+        // 0.05 lets the inspector take 5% of frame time before it degrades
+        void setBudget (double share) { budget = juce::jlimit (0.001, 1.0, share); }
+        [[nodiscard]] double getBudget() const noexcept { return budget; }
+
+        // true from a window over budget until one under half the budget
+        bool isOverBudget()
+        {
+            update();
+            return overBudget;
+        }
+
+    private:
+        std::array<juce::int64, numSubsystems> ticks {};
+        std::array<double, numSubsystems> shares {};
+        int active = -1;
+        juce::int64 activeSince = 0;
+        juce::int64 windowStart = juce::Time::getHighResolutionTicks();
+        double budget = 0.05;
+        bool overBudget = false;
+
+        InspectorCost() = default;
+
+        int enter (Subsystem s)
+        {
+            JUCE_ASSERT_MESSAGE_THREAD
+
+            auto now = juce::Time::getHighResolutionTicks();
+            charge (now);
+            return std::exchange (active, (int) s);
+        }
+
+        void exit (int previous)
+        {
+            charge (juce::Time::getHighResolutionTicks());
+            active = previous;
+            update();
+        }
+
+        void charge (juce::int64 now)
+        {
+            if (active >= 0)
+                ticks[(size_t) active] += now - activeSince;
+            activeSince = now;
+        }
+
+        void update()
+        {
+            auto now = juce::Time::getHighResolutionTicks();
+            auto elapsed = now - windowStart;
+            if (juce::Time::highResolutionTicksToSeconds (elapsed) * 1000.0 < windowMs)
+                return;
+
+            // whatever is running now counts towards this window
+            charge (now);
+
+            double total = 0;
+            for (size_t i = 0; i < shares.size(); ++i)
+            {
+                shares[i] = (double) ticks[i] / (double) elapsed;
+                total += shares[i];
+                ticks[i] = 0;
+            }
+            windowStart = now;
+
+            // hysteresis, so features don't flicker on and off around the budget
+            if (total > budget)
+                overBudget = true;
+            else if (total < budget * 0.5)
+                overBudget = false;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (InspectorCost)
+    };
+}
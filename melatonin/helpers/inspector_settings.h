@@ -4,8 +4,18 @@ namespace melatonin
 {
     // We have to avoid using ApplicationProperties in a SharedResourcePointer
     // as we don't want to screw up the app's properties file
-    struct InspectorSettings
+    //
+    // props is only ever written to in memory. Changes are batched and, once things
+    // have been quiet for a moment, written as JSON on a background thread
+    // (via a temporary file and a rename), so dragging the inspector around never touches the disk.
+    struct InspectorSettings : private juce::ChangeListener, private juce::Timer
     {
+        // how long settings have to stop changing before they are written
+        static constexpr int debounceMs = 500;
+
+        // continuous changes (like a window drag) still get written this often
+        static constexpr juce::uint32 maxDelayMs = 3000;
+
         InspectorSettings()
         {
             juce::PropertiesFile::Options opts;
@@ -16,18 +26,166 @@ namespace melatonin
             opts.osxLibrarySubFolder = "Application Support";
             opts.commonToAllUsers = false;
             opts.ignoreCaseOfKeyNames = false;
-            opts.doNotSave = false;
-            opts.millisecondsBeforeSaving = 1;
+            opts.doNotSave = true; // the writer owns the file
+            opts.millisecondsBeforeSaving = -1;
             opts.storageFormat = juce::PropertiesFile::storeAsXML;
-            props = std::make_unique<juce::PropertiesFile> (opts);
+
+            auto legacyFile = opts.getDefaultFile();
+            writer.file = legacyFile.withFileExtension ("json");
+
+            if (writer.file.existsAsFile())
+            {
+                // starts out empty, as it can't parse JSON
+                props = std::make_unique<juce::PropertiesFile> (writer.file, opts);
+                loadJson (writer.file);
+            }
+            else
+            {
+                // migrate the old XML settings over
+                props = std::make_unique<juce::PropertiesFile> (opts);
+                if (legacyFile.existsAsFile())
+                    scheduleSave();
+            }
+
+            props->addChangeListener (this);
+            writer.startThread (juce::Thread::Priority::low);
         }
 
-        void saveIfNeeded() const
+        ~InspectorSettings() override
         {
-            props->saveIfNeeded();
+            stopTimer();
+            flush();
+
+            // the writer drains what's pending before it exits
+            writer.signalThreadShouldExit();
+            writer.notify();
+            writer.stopThread (2000);
+        }
+
+        // hands the current settings to the writer right away, otherwise changes are picked up on their own
+        void flush()
+        {
+            stopTimer();
+            firstPendingChange = 0;
+
+            if (props == nullptr)
+                return;
+
+            auto object = std::make_unique<juce::DynamicObject>();
+            auto& all = props->getAllProperties();
+            for (int i = 0; i < all.size(); ++i)
+                object->setProperty (all.getAllKeys()[i], all.getAllValues()[i]);
+
+            writer.write (juce::JSON::toString (juce::var (object.release())));
         }
 
         // this is a unique_ptr because our object must be default constructable
         std::unique_ptr<juce::PropertiesFile> props;
+
+    private:
+        class Writer : public juce::Thread
+        {
+        public:
+            Writer() : juce::Thread ("Melatonin Settings Writer") {}
+
+            juce::File file;
+
+            void write (const juce::String& contents)
+            {
+                {
+                    const juce::ScopedLock lock (pendingLock);
+                    pending = contents;
+                    hasPending = true;
+                }
+                notify();
+            }
+
+            void run() override
+            {
+                while (true)
+                {
+                    juce::String contents;
+                    bool hasContents = false;
+                    {
+                        const juce::ScopedLock lock (pendingLock);
+                        std::swap (hasContents, hasPending);
+                        contents.swapWith (pending);
+                    }
+
+                    // only the latest settings matter, older pending writes were replaced
+                    if (hasContents)
+                    {
+                        if (writeNow (contents) || threadShouldExit())
+                            continue;
+
+                        // the disk may be full or the folder read only, try again in a bit unless newer settings arrive
+                        {
+                            const juce::ScopedLock lock (pendingLock);
+                            if (!hasPending)
+                            {
+                                pending = contents;
+                                hasPending = true;
+                            }
+                        }
+                        wait (retryMs);
+                        continue;
+                    }
+
+                    if (threadShouldExit())
+                        return;
+
+                    wait (-1);
+                }
+            }
+
+        private:
+            static constexpr int retryMs = 5000;
+
+            juce::CriticalSection pendingLock;
+            juce::String pending;
+            bool hasPending = false;
+
+            bool writeNow (const juce::String& contents) const
+            {
+                // there might not be any settings yet, not even the old XML ones
+                if (!file.getParentDirectory().createDirectory())
+                    return false;
+
+                // writes a temporary file and renames it, so a crash never leaves a half written file
+                return file.replaceWithText (contents);
+            }
+        };
+
+        Writer writer;
+        juce::uint32 firstPendingChange = 0;
+
+        void loadJson (const juce::File& file)
+        {
+            if (auto* object = juce::JSON::parse (file).getDynamicObject())
+                for (auto& property : object->getProperties())
+                    props->setValue (property.name.toString(), property.value);
+        }
+
+        void scheduleSave()
+        {
+            auto now = juce::Time::getMillisecondCounter();
+            if (firstPendingChange == 0)
+                firstPendingChange = now;
+
+            if (now - firstPendingChange >= maxDelayMs)
+                flush();
+            else
+                startTimer (debounceMs);
+        }
+
+        void changeListenerCallback (juce::ChangeBroadcaster*) override
+        {
+            scheduleSave();
+        }
+
+        void timerCallback() override
+        {
+            flush();
+        }
     };
 }
@@ -3,6 +3,13 @@
 #include "../../LatestCompiledAssets/InspectorBinaryData.h"
 #include <juce_audio_processors/juce_audio_processors.h>
 
+// VBlank was added in 7.0.3
+#if (JUCE_MAJOR_VERSION >= 7) && (JUCE_MINOR_VERSION >= 1 || JUCE_BUILDNUMBER >= 3)
+    #define MELATONIN_VBLANK 1
+#else
+    #define MELATONIN_VBLANK 0
+#endif
+
 namespace melatonin
 {
     static inline juce::String dimensionsString (juce::Rectangle<int> bounds)
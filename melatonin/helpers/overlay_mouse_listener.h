@@ -1,11 +1,15 @@
 #pragma once
+#include "inspector_cost.h"
 #include "juce_gui_basics/juce_gui_basics.h"
 
 namespace melatonin
 {
     // Unfortunately the DocumentWindow cannot behave as our root component mouse listener
     // without some strange side effects. That's why we are doing the whole lambda dance...
-    class OverlayMouseListener : public juce::MouseListener
+    //
+    // Hovering is split in two: the outline follows the mouse immediately, while
+    // hoverComponentCallback (model, preview, properties) waits for the pointer to dwell
+    class OverlayMouseListener : public juce::MouseListener, private juce::Timer
     {
     public:
         OverlayMouseListener()
@@ -14,6 +18,7 @@ namespace melatonin
 
         ~OverlayMouseListener() override
         {
+            stopTimer();
             if (enabled && root)
                 root->removeMouseListener (this);
         }
@@ -28,6 +33,7 @@ namespace melatonin
 
         void clearRoot()
         {
+            cancelHover();
             if (enabled && root)
                 root->removeMouseListener (this);
 
@@ -49,6 +55,7 @@ namespace melatonin
                 return;
 
             enabled = false;
+            cancelHover();
             root->removeMouseListener (this);
         }
 
@@ -57,13 +64,35 @@ namespace melatonin
             dragEnabled = enable;
         }
 
+        // 0 runs the hover work on every enter, like before
+        void setHoverDwellTime (int milliseconds)
+        {
+            dwellMs = juce::jmax (0, milliseconds);
+        }
+
         void mouseEnter (const juce::MouseEvent& event) override
         {
+            InspectorCost::Scope cost (InspectorCost::mouseListener);
             outlineComponentCallback (event.originalComponent);
+            scheduleHover (event.originalComponent, event.getEventRelativeTo (root).position);
         }
 
         void mouseMove (const juce::MouseEvent& event) override
         {
+            InspectorCost::Scope cost (InspectorCost::mouseListener);
+            // the pointer is settling on the pending component, no need to wait out the dwell
+            if (isTimerRunning() && event.originalComponent == pendingHover.getComponent())
+            {
+                auto now = juce::Time::getMillisecondCounter();
+                auto position = event.getEventRelativeTo (root).position;
+                auto elapsed = (float) juce::jmax (1u, now - lastMoveTime);
+                if (position.getDistanceFrom (lastMovePosition) / elapsed < settleSpeed)
+                    flushHover();
+
+                lastMoveTime = now;
+                lastMovePosition = position;
+            }
+
             if (outlineDistanceCallback && event.mods.isAltDown())
                 outlineDistanceCallback (event.originalComponent);
             else
@@ -72,15 +101,21 @@ namespace melatonin
 
         void mouseUp (const juce::MouseEvent& event) override
         {
+            InspectorCost::Scope cost (InspectorCost::mouseListener);
             if (event.mods.isLeftButtonDown())
             {
+                cancelHover();
                 selectComponentCallback (event.originalComponent);
             }
+
+            if (isDragging && componentDragEndedCallback)
+                componentDragEndedCallback();
             isDragging = false;
         }
 
         void mouseDown (const juce::MouseEvent& event) override
         {
+            InspectorCost::Scope cost (InspectorCost::mouseListener);
             if (!dragEnabled)
                 return;
 
@@ -92,6 +127,7 @@ namespace melatonin
 
         void mouseDrag (const juce::MouseEvent& event) override
         {
+            InspectorCost::Scope cost (InspectorCost::mouseListener);
             if (!dragEnabled)
                 return;
 
@@ -105,6 +141,7 @@ namespace melatonin
 
         void mouseExit (const juce::MouseEvent& event) override
         {
+            InspectorCost::Scope cost (InspectorCost::mouseListener);
             if (event.originalComponent == root)
             {
                 // TODO: Sudara is wondering if this callback is needed...
@@ -113,14 +150,21 @@ namespace melatonin
 
             // not sure if there's a better way to ask "is the mouse outside the plugin now?"
             if (!root->contains (event.getEventRelativeTo (root).position))
+            {
+                cancelHover();
                 outlineComponentCallback (nullptr);
+                if (hoverComponentCallback)
+                    hoverComponentCallback (nullptr);
+            }
         }
 
         std::function<void (juce::Component* c)> outlineComponentCallback;
+        std::function<void (juce::Component* c)> hoverComponentCallback;
         std::function<void (juce::Component* c)> outlineDistanceCallback;
         std::function<void (juce::Component* c)> selectComponentCallback;
         std::function<void (juce::Component* c, const juce::MouseEvent& e)> componentStartDraggingCallback;
         std::function<void (juce::Component* c, const juce::MouseEvent& e)> componentDraggedCallback;
+        std::function<void()> componentDragEndedCallback;
         std::function<void()> mouseExitCallback;
 
     private:
@@ -130,5 +174,49 @@ namespace melatonin
         bool enabled = false;
         bool isDragging { false };
         bool dragEnabled { false };
+
+        int dwellMs = 120;
+        static constexpr float settleSpeed = 0.05f; // px per ms
+        juce::Component::SafePointer<juce::Component> pendingHover;
+        juce::uint32 lastMoveTime = 0;
+        juce::Point<float> lastMovePosition;
+
+        // restarting the timer drops whatever was pending for the last component
+        void scheduleHover (juce::Component* c, juce::Point<float> position)
+        {
+            pendingHover = c;
+            if (dwellMs == 0)
+            {
+                flushHover();
+                return;
+            }
+
+            lastMoveTime = juce::Time::getMillisecondCounter();
+            lastMovePosition = position;
+            startTimer (dwellMs);
+        }
+
+        void cancelHover()
+        {
+            stopTimer();
+            pendingHover = nullptr;
+        }
+
+        void flushHover()
+        {
+            stopTimer();
+
+            // the component may have gone away while we waited
+            if (auto* c = pendingHover.getComponent(); c != nullptr && hoverComponentCallback)
+                hoverComponentCallback (c);
+
+            pendingHover = nullptr;
+        }
+
+        void timerCallback() override
+        {
+            InspectorCost::Scope cost (InspectorCost::mouseListener);
+            flushHover();
+        }
     };
 }
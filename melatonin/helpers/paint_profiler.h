@@ -0,0 +1,172 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <atomic>
+#include <vector>
+
+namespace melatonin
+{
+    // Captures every ComponentTimer paint into per-frame buckets while recording
+    // Frames are delimited by whoever owns the recording (the inspector uses VBlank)
+    // All storage is allocated up front, recording a paint never allocates
+    class PaintProfiler
+    {
+    public:
+        static constexpr int maxFrames = 120;
+        static constexpr int maxEventsPerFrame = 2048;
+
+        struct Event
+        {
+            // never dereferenced here, the component may be gone by the time the frame is shown
+            // (a SafePointer could allocate the component's WeakReference master while recording)
+            juce::Component* component = nullptr;
+            juce::int64 startTicks = 0;
+            juce::int64 endTicks = 0;
+            int depth = 0; // number of timed ancestors
+        };
+
+        struct Frame
+        {
+            juce::int64 startTicks = 0;
+            juce::int64 endTicks = 0;
+            int numEvents = 0;
+            int numDropped = 0;
+            std::vector<Event> events;
+
+            [[nodiscard]] double getPaintSeconds() const
+            {
+                juce::int64 total = 0;
+                for (int i = 0; i < numEvents; ++i)
+                    total += events[(size_t) i].endTicks - events[(size_t) i].startTicks;
+                return juce::Time::highResolutionTicksToSeconds (total);
+            }
+        };
+
+        static PaintProfiler& getInstance()
+        {
+            static PaintProfiler instance;
+            return instance;
+        }
+
+        // checked by every ComponentTimer, so keep it to one relaxed load
+        static bool isRecording() noexcept
+        {
+            return recordingFlag().load (std::memory_order_relaxed);
+        }
+
+        void start()
+        {
+            JUCE_ASSERT_MESSAGE_THREAD
+
+            if (frames.empty())
+            {
+                frames.resize (maxFrames + 1);
+                for (auto& f : frames)
+                    f.events.resize (maxEventsPerFrame);
+            }
+
+            numCompletedFrames = 0;
+            nextFrameIndex = 0;
+            beginFrame (juce::Time::getHighResolutionTicks());
+            recordingFlag().store (true, std::memory_order_relaxed);
+        }
+
+        void stop()
+        {
+            JUCE_ASSERT_MESSAGE_THREAD
+
+            recordingFlag().store (false, std::memory_order_relaxed);
+            nextFrame();
+        }
+
+        // call at every frame boundary, idle frames without paints are discarded
+        void nextFrame()
+        {
+            if (frames.empty())
+                return;
+
+            auto now = juce::Time::getHighResolutionTicks();
+            auto& frame = currentFrame();
+            if (frame.numEvents > 0)
+            {
+                frame.endTicks = juce::jmax (now, frame.events[(size_t) frame.numEvents - 1].endTicks);
+                nextFrameIndex = (nextFrameIndex + 1) % (int) frames.size();
+                numCompletedFrames = juce::jmin (numCompletedFrames + 1, maxFrames);
+            }
+
+            beginFrame (now);
+        }
+
+        // paints happen on the message thread, as does everything else here
+        void record (juce::Component* component, juce::int64 startTicks, juce::int64 endTicks, int depth) noexcept
+        {
+            if (frames.empty())
+                return;
+
+            auto& frame = currentFrame();
+            if (frame.numEvents >= maxEventsPerFrame)
+            {
+                ++frame.numDropped;
+                return;
+            }
+
+            auto& event = frame.events[(size_t) frame.numEvents++];
+            event.component = component;
+            event.startTicks = startTicks;
+            event.endTicks = endTicks;
+            event.depth = depth;
+        }
+
+        [[nodiscard]] int getNumFrames() const noexcept { return numCompletedFrames; }
+
+        // 0 is the oldest frame still in the buffer
+        [[nodiscard]] const Frame& getFrame (int index) const
+        {
+            jassert (juce::isPositiveAndBelow (index, numCompletedFrames));
+            auto size = (int) frames.size();
+            return frames[(size_t) ((nextFrameIndex - numCompletedFrames + index + size) % size)];
+        }
+
+        [[nodiscard]] int getSlowestFrameIndex() const
+        {
+            int slowest = -1;
+            double slowestSeconds = 0;
+            for (int i = 0; i < numCompletedFrames; ++i)
+            {
+                auto seconds = getFrame (i).getPaintSeconds();
+                if (slowest < 0 || seconds > slowestSeconds)
+                {
+                    slowest = i;
+                    slowestSeconds = seconds;
+                }
+            }
+            return slowest;
+        }
+
+    private:
+        // one extra frame is always the one being recorded into
+        std::vector<Frame> frames;
+        int nextFrameIndex = 0;
+        int numCompletedFrames = 0;
+
+        PaintProfiler() = default;
+
+        static std::atomic<bool>& recordingFlag()
+        {
+            static std::atomic<bool> flag { false };
+            return flag;
+        }
+
+        Frame& currentFrame() { return frames[(size_t) nextFrameIndex]; }
+
+        void beginFrame (juce::int64 now)
+        {
+            auto& frame = currentFrame();
+            frame.startTicks = now;
+            frame.endTicks = now;
+            frame.numEvents = 0;
+            frame.numDropped = 0;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (PaintProfiler)
+    };
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "juce_gui_basics/juce_gui_basics.h"
+#include <cstring>
+
+namespace melatonin
+{
+    // A 1x copy of everything the root component has painted, used by the eyedropper
+    //
+    // An invisible, always-on-top child of the root receives a paint call for
+    // every region the target UI repaints. Those regions are marked stale and are
+    // only re-rendered when a copy is requested from them. Moving the loupe over
+    // an unchanged UI is then a memcpy instead of a re-render of whatever is under it.
+    class RootBackbuffer : private juce::Component, private juce::ComponentListener
+    {
+    public:
+        static constexpr const char* componentName = "Melatonin Repaint Tracker";
+
+        RootBackbuffer()
+        {
+            setName (componentName);
+            setAlwaysOnTop (true);
+            setInterceptsMouseClicks (false, false);
+            setAccessible (false);
+        }
+
+        ~RootBackbuffer() override
+        {
+            detach();
+        }
+
+        void attach (juce::Component& newRoot)
+        {
+            if (root == &newRoot)
+                return;
+
+            detach();
+            root = &newRoot;
+            root->addComponentListener (this);
+            root->addAndMakeVisible (this);
+            setBounds (root->getLocalBounds());
+            invalidateAll();
+        }
+
+        void detach()
+        {
+            if (root != nullptr)
+            {
+                root->removeComponentListener (this);
+                root->removeChildComponent (this);
+            }
+
+            root = nullptr;
+            backbuffer = juce::Image();
+            stale.clear();
+        }
+
+        // copies an area of the root (in root coordinates) into dest, re-rendering only stale pixels
+        // dest is reallocated only when the area changes size, pixels outside the root are transparent
+        void copyTo (juce::Image& dest, juce::Rectangle<int> area)
+        {
+            TRACE_COMPONENT();
+
+            if (dest.getWidth() != area.getWidth() || dest.getHeight() != area.getHeight() || dest.getFormat() != juce::Image::ARGB)
+                dest = juce::Image (juce::Image::ARGB, area.getWidth(), area.getHeight(), true, juce::SoftwareImageType());
+            else
+                dest.clear (dest.getBounds());
+
+            if (root == nullptr)
+                return;
+
+            ensureBackbufferSize();
+
+            auto source = area.getIntersection (backbuffer.getBounds());
+            if (source.isEmpty())
+                return;
+
+            render (source);
+
+            juce::Image::BitmapData from (backbuffer, source.getX(), source.getY(), source.getWidth(), source.getHeight(), juce::Image::BitmapData::readOnly);
+            juce::Image::BitmapData to (dest, source.getX() - area.getX(), source.getY() - area.getY(), source.getWidth(), source.getHeight(), juce::Image::BitmapData::writeOnly);
+
+            auto bytesPerLine = (size_t) (source.getWidth() * from.pixelStride);
+            for (int y = 0; y < source.getHeight(); ++y)
+                std::memcpy (to.getLinePointer (y), from.getLinePointer (y), bytesPerLine);
+        }
+
+        void invalidateAll()
+        {
+            stale = juce::RectangleList<int> (getLocalBounds());
+        }
+
+    private:
+        juce::Component::SafePointer<juce::Component> root;
+        juce::Image backbuffer;
+        juce::RectangleList<int> stale;
+        bool rendering = false;
+
+        // we sit at the root's origin, so the clip is the repainted region in root coordinates
+        void paint (juce::Graphics& g) override
+        {
+            if (!rendering)
+                stale.add (g.getClipBounds());
+        }
+
+        void componentMovedOrResized (juce::Component& c, bool, bool wasResized) override
+        {
+            if (&c == root && wasResized)
+                setBounds (root->getLocalBounds());
+        }
+
+        void componentBeingDeleted (juce::Component& c) override
+        {
+            if (&c == root)
+                detach();
+        }
+
+        void ensureBackbufferSize()
+        {
+            auto bounds = root->getLocalBounds();
+            if (backbuffer.getBounds() == bounds)
+                return;
+
+            backbuffer = juce::Image (juce::Image::ARGB, juce::jmax (1, bounds.getWidth()), juce::jmax (1, bounds.getHeight()), true, juce::SoftwareImageType());
+            invalidateAll();
+        }
+
+        void render (juce::Rectangle<int> area)
+        {
+            auto toRender = stale;
+            toRender.clipTo (area);
+            if (toRender.isEmpty())
+                return;
+
+            // one paint of the enclosing rect is cheaper than a paint per fragment
+            auto bounds = toRender.getBounds();
+            backbuffer.clear (bounds);
+            {
+                const juce::ScopedValueSetter<bool> ignoreOurOwnPaint (rendering, true);
+                juce::Graphics g (backbuffer);
+                g.reduceClipRegion (bounds);
+                root->paintEntireComponent (g, true);
+            }
+            stale.subtract (bounds);
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RootBackbuffer)
+    };
+}
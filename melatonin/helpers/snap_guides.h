@@ -0,0 +1,226 @@
+#pragma once
+#include "juce_gui_basics/juce_gui_basics.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+namespace melatonin
+{
+    // Figma style smart guides for drag mode
+    //
+    // When a drag starts, the edges and centres of the parent and every visible sibling
+    // go into sorted tables, along with the positions that would repeat an existing gap
+    // between neighbouring siblings. Each drag event is then a handful of binary searches,
+    // no matter how many siblings there are. Everything is in the parent's coordinates.
+    class SnapGuides
+    {
+    public:
+        int threshold = 5;
+
+        void build (juce::Component& dragged)
+        {
+            TRACE_COMPONENT();
+
+            clear();
+            auto* parent = dragged.getParentComponent();
+            if (parent == nullptr)
+                return;
+
+            builtFor = parent;
+            rects.push_back (parent->getLocalBounds());
+            for (auto* sibling : parent->getChildren())
+                if (sibling != &dragged && sibling->isVisible() && !sibling->getBounds().isEmpty())
+                    rects.push_back (sibling->getBounds());
+
+            for (int i = 0; i < (int) rects.size(); ++i)
+            {
+                auto& r = rects[(size_t) i];
+                for (auto x : { r.getX(), r.getCentreX(), r.getRight() })
+                    xEdges.push_back ({ x, i, -1 });
+                for (auto y : { r.getY(), r.getCentreY(), r.getBottom() })
+                    yEdges.push_back ({ y, i, -1 });
+            }
+
+            addSpacing (true);
+            addSpacing (false);
+
+            for (auto* table : { &xEdges, &yEdges, &leftSpacing, &rightSpacing, &topSpacing, &bottomSpacing })
+                std::sort (table->begin(), table->end(), [] (const Edge& a, const Edge& b) { return a.value < b.value; });
+        }
+
+        void clear()
+        {
+            builtFor = nullptr;
+            rects.clear();
+            for (auto* table : { &xEdges, &yEdges, &leftSpacing, &rightSpacing, &topSpacing, &bottomSpacing })
+                table->clear();
+            guides.clear();
+        }
+
+        // the tables belong to the parent at drag start, the inspector can reparent mid drag
+        [[nodiscard]] bool isBuiltFor (juce::Component* parent) const noexcept { return parent != nullptr && builtFor == parent; }
+
+        // returns proposed moved onto the nearest guide on each axis, if one is within the threshold
+        juce::Rectangle<int> snap (juce::Rectangle<int> proposed)
+        {
+            guides.clear();
+            if (rects.empty())
+                return proposed;
+
+            auto x = proposed.getX() + bestDelta (proposed, true);
+            auto y = proposed.getY() + bestDelta (proposed, false);
+            auto snapped = proposed.withPosition (x, y);
+
+            addGuides (snapped, true);
+            addGuides (snapped, false);
+            return snapped;
+        }
+
+        // lines to draw for the last snap, in the parent's coordinates
+        [[nodiscard]] const std::vector<juce::Line<int>>& getGuides() const noexcept { return guides; }
+
+    private:
+        struct Edge
+        {
+            int value;
+            int rect; // the rect this edge belongs to, or the neighbour a gap is repeated after
+            int other; // for gaps, the other rect of the reference gap
+        };
+
+        juce::Component::SafePointer<juce::Component> builtFor;
+        std::vector<juce::Rectangle<int>> rects; // the parent's local bounds, then siblings
+        std::vector<Edge> xEdges, yEdges;
+
+        // where the dragged rect's edge would go to repeat an existing gap
+        std::vector<Edge> leftSpacing, rightSpacing, topSpacing, bottomSpacing;
+        std::vector<juce::Line<int>> guides;
+
+        static int start (juce::Rectangle<int> r, bool horizontal) { return horizontal ? r.getX() : r.getY(); }
+        static int end (juce::Rectangle<int> r, bool horizontal) { return horizontal ? r.getRight() : r.getBottom(); }
+        static int crossStart (juce::Rectangle<int> r, bool horizontal) { return horizontal ? r.getY() : r.getX(); }
+        static int crossEnd (juce::Rectangle<int> r, bool horizontal) { return horizontal ? r.getBottom() : r.getRight(); }
+
+        static bool overlapAcross (juce::Rectangle<int> a, juce::Rectangle<int> b, bool horizontal)
+        {
+            return crossStart (a, horizontal) < crossEnd (b, horizontal) && crossStart (b, horizontal) < crossEnd (a, horizontal);
+        }
+
+        // neighbouring siblings in a row (or column) define a gap worth repeating on either side
+        void addSpacing (bool horizontal)
+        {
+            std::vector<int> order;
+            for (int i = 1; i < (int) rects.size(); ++i)
+                order.push_back (i);
+
+            std::sort (order.begin(), order.end(), [&] (int a, int b) { return start (rects[(size_t) a], horizontal) < start (rects[(size_t) b], horizontal); });
+
+            for (size_t i = 1; i < order.size(); ++i)
+            {
+                auto& a = rects[(size_t) order[i - 1]];
+                auto& b = rects[(size_t) order[i]];
+                auto gap = start (b, horizontal) - end (a, horizontal);
+                if (gap <= 0 || !overlapAcross (a, b, horizontal))
+                    continue;
+
+                (horizontal ? leftSpacing : topSpacing).push_back ({ end (b, horizontal) + gap, order[i], order[i - 1] });
+                (horizontal ? rightSpacing : bottomSpacing).push_back ({ start (a, horizontal) - gap, order[i - 1], order[i] });
+            }
+        }
+
+        // closest table entry to value, as a delta, or threshold + 1 when nothing is close enough
+        int nearest (const std::vector<Edge>& table, int value) const
+        {
+            auto found = std::lower_bound (table.begin(), table.end(), value, [] (const Edge& e, int v) { return e.value < v; });
+            auto best = threshold + 1;
+            if (found != table.end() && std::abs (found->value - value) < std::abs (best))
+                best = found->value - value;
+            if (found != table.begin() && std::abs (std::prev (found)->value - value) < std::abs (best))
+                best = std::prev (found)->value - value;
+            return best;
+        }
+
+        // like nearest, but only gaps in the same row (or column) as the dragged rect count
+        int nearestSpacing (const std::vector<Edge>& table, int value, juce::Rectangle<int> proposed, bool horizontal) const
+        {
+            auto best = threshold + 1;
+            auto consider = [&] (const Edge& edge) {
+                if (std::abs (edge.value - value) < std::abs (best) && overlapAcross (proposed, rects[(size_t) edge.rect], horizontal))
+                    best = edge.value - value;
+            };
+
+            // only entries within the threshold can win, so just scan that window
+            auto found = std::lower_bound (table.begin(), table.end(), value - threshold, [] (const Edge& e, int v) { return e.value < v; });
+            for (auto it = found; it != table.end() && it->value <= value + threshold; ++it)
+                consider (*it);
+
+            return best;
+        }
+
+        int bestDelta (juce::Rectangle<int> proposed, bool horizontal) const
+        {
+            auto& edges = horizontal ? xEdges : yEdges;
+            auto s = start (proposed, horizontal);
+            auto e = end (proposed, horizontal);
+
+            auto best = threshold + 1;
+            for (auto delta : { nearest (edges, s), nearest (edges, (s + e) / 2), nearest (edges, e),
+                     nearestSpacing (horizontal ? leftSpacing : topSpacing, s, proposed, horizontal),
+                     nearestSpacing (horizontal ? rightSpacing : bottomSpacing, e, proposed, horizontal) })
+            {
+                if (std::abs (delta) < std::abs (best))
+                    best = delta;
+            }
+
+            return std::abs (best) <= threshold ? best : 0;
+        }
+
+        template <typename Callback>
+        static void forEachAt (const std::vector<Edge>& table, int value, Callback&& callback)
+        {
+            auto range = std::equal_range (table.begin(), table.end(), Edge { value, 0, 0 }, [] (const Edge& a, const Edge& b) { return a.value < b.value; });
+            for (auto it = range.first; it != range.second; ++it)
+                callback (*it);
+        }
+
+        // a line at position across the rect and everything aligned with it
+        juce::Line<int> alignmentLine (int position, juce::Rectangle<int> snapped, juce::Rectangle<int> other, bool horizontal) const
+        {
+            auto from = juce::jmin (crossStart (snapped, horizontal), crossStart (other, horizontal));
+            auto to = juce::jmax (crossEnd (snapped, horizontal), crossEnd (other, horizontal));
+            return horizontal ? juce::Line<int> (position, from, position, to) : juce::Line<int> (from, position, to, position);
+        }
+
+        // a line spanning the gap between two rects, through the middle of the first
+        static juce::Line<int> gapLine (juce::Rectangle<int> a, juce::Rectangle<int> b, bool horizontal)
+        {
+            auto& first = start (a, horizontal) < start (b, horizontal) ? a : b;
+            auto& second = &first == &a ? b : a;
+            auto across = (crossStart (first, horizontal) + crossEnd (first, horizontal)) / 2;
+            return horizontal ? juce::Line<int> (end (first, true), across, start (second, true), across)
+                              : juce::Line<int> (across, end (first, false), across, start (second, false));
+        }
+
+        void addGuides (juce::Rectangle<int> snapped, bool horizontal)
+        {
+            auto& edges = horizontal ? xEdges : yEdges;
+            auto s = start (snapped, horizontal);
+            auto e = end (snapped, horizontal);
+
+            for (auto position : { s, (s + e) / 2, e })
+                forEachAt (edges, position, [&] (const Edge& edge) {
+                    guides.push_back (alignmentLine (position, snapped, rects[(size_t) edge.rect], horizontal));
+                });
+
+            auto addGap = [&] (const Edge& edge) {
+                if (!overlapAcross (snapped, rects[(size_t) edge.rect], horizontal))
+                    return;
+
+                guides.push_back (gapLine (rects[(size_t) edge.rect], snapped, horizontal));
+                guides.push_back (gapLine (rects[(size_t) edge.rect], rects[(size_t) edge.other], horizontal));
+            };
+            forEachAt (horizontal ? leftSpacing : topSpacing, s, addGap);
+            forEachAt (horizontal ? rightSpacing : bottomSpacing, e, addGap);
+        }
+    };
+}
@@ -1,12 +1,344 @@
 #pragma once
+#include "paint_profiler.h"
 #include <juce_gui_basics/juce_gui_basics.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
 
 namespace melatonin
 {
+    // Constant memory, log bucketed (HDR style) histogram of paint times
+    // 8 buckets per doubling from 1µs to ~1s gives ~6% precision on quantiles
+    class PaintHistogram
+    {
+    public:
+        static constexpr int bucketsPerOctave = 8;
+        static constexpr int numOctaves = 20;
+        static constexpr int numBuckets = 1 + bucketsPerOctave * numOctaves;
+
+        // single writer
+        void add (double seconds) noexcept
+        {
+            auto& bucket = counts[(size_t) bucketFor (seconds)];
+            bucket.store (bucket.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            total.store (total.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // q from 0 to 1, returns 0 when empty
+        [[nodiscard]] double getQuantile (double q) const noexcept
+        {
+            auto numValues = getTotal();
+            if (numValues == 0)
+                return 0.0;
+
+            auto target = (juce::uint32) juce::jlimit (1.0, (double) numValues, std::ceil (q * (double) numValues));
+            juce::uint32 cumulative = 0;
+            for (int i = 0; i < numBuckets; ++i)
+            {
+                cumulative += getCount (i);
+                if (cumulative >= target)
+                    return getBucketValue (i);
+            }
+
+            return getBucketValue (numBuckets - 1);
+        }
+
+        [[nodiscard]] juce::uint32 getCount (int bucket) const noexcept { return counts[(size_t) bucket].load (std::memory_order_relaxed); }
+        [[nodiscard]] juce::uint32 getTotal() const noexcept { return total.load (std::memory_order_acquire); }
+
+        // representative (mid) value of a bucket, in seconds
+        [[nodiscard]] static double getBucketValue (int bucket) noexcept
+        {
+            if (bucket <= 0)
+                return 0.5e-6;
+
+            auto octave = (bucket - 1) / bucketsPerOctave;
+            auto sub = (bucket - 1) % bucketsPerOctave;
+            return std::ldexp (1.0 + (sub + 0.5) / bucketsPerOctave, octave) * 1e-6;
+        }
+
+        [[nodiscard]] static int bucketFor (double seconds) noexcept
+        {
+            auto micros = seconds * 1e6;
+            if (!(micros >= 1.0))
+                return 0;
+
+            int exponent = 0;
+            auto mantissa = std::frexp (micros, &exponent); // micros = mantissa * 2^exponent, mantissa in [0.5, 1)
+            auto octave = exponent - 1;
+            auto sub = juce::jlimit (0, bucketsPerOctave - 1, (int) ((mantissa * 2.0 - 1.0) * bucketsPerOctave));
+            return juce::jmin (numBuckets - 1, 1 + octave * bucketsPerOctave + sub);
+        }
+
+        void reset() noexcept
+        {
+            for (auto& c : counts)
+                c.store (0, std::memory_order_relaxed);
+            total.store (0, std::memory_order_release);
+        }
+
+    private:
+        std::array<std::atomic<juce::uint32>, numBuckets> counts {};
+        std::atomic<juce::uint32> total { 0 };
+    };
+
+    // Paint timing history for a single component
+    // Lives in the component's properties and is looked up once per paint,
+    // so recording a timing is a couple of atomic stores into a ring buffer
+    //
+    // Each record also knows its nearest timed ancestor. When a paint completes,
+    // the change in its latest time is bubbled up that chain, so "with children"
+    // (inclusive) time is always available without walking the subtree.
+    // When anything above the component is reparented, its time is taken back out of
+    // that chain until its next paint finds the new one.
+    class ComponentTiming : public juce::ReferenceCountedObject, private juce::ComponentListener
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<ComponentTiming>;
+        static constexpr int historySize = 64;
+
+        ~ComponentTiming() override
+        {
+            if (component != nullptr)
+                component->removeComponentListener (this);
+
+            // we no longer count towards our ancestors
+            detachFromParent();
+        }
+
+        // returns the component's timing history, creating it if needed
+        static ComponentTiming& forComponent (juce::Component& c)
+        {
+            if (auto* existing = find (&c))
+                return *existing;
+
+            auto* timing = new ComponentTiming (c);
+            c.getProperties().set (propertyName(), juce::var (timing));
+
+            // existing records might have this one as their new nearest timed ancestor
+            ++generation();
+            return *timing;
+        }
+
+        // nullptr when the component has never been timed
+        static ComponentTiming* find (const juce::Component* c)
+        {
+            if (c == nullptr)
+                return nullptr;
+
+            if (auto* v = c->getProperties().getVarPointer (propertyName()))
+                return dynamic_cast<ComponentTiming*> (v->getObject());
+
+            return nullptr;
+        }
+
+        static const juce::Identifier& propertyName()
+        {
+            static const juce::Identifier name { "melatoninTiming" };
+            return name;
+        }
+
+        // single writer (the thread painting the component), any number of readers
+        void addSample (double seconds) noexcept
+        {
+            auto count = numSamples.load (std::memory_order_relaxed);
+            auto previous = getSample (0);
+            resolveParentIfNeeded();
+
+            samples[(size_t) (count % historySize)].store (seconds, std::memory_order_relaxed);
+
+            if (seconds > max.load (std::memory_order_relaxed))
+                max.store (seconds, std::memory_order_relaxed);
+
+            histogram.add (seconds);
+            numSamples.store (count + 1, std::memory_order_release);
+
+            bubble (parent.get(), seconds - previous);
+            for (auto* t = this; t != nullptr; t = t->parent.get())
+                t->paints.store (t->paints.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+
+            // our children paint after us, so this uses their times from the previous paint
+            auto inclusive = seconds + descendantsLast.load (std::memory_order_relaxed);
+            inclusiveHistogram.add (inclusive);
+            if (inclusive > inclusiveMax.load (std::memory_order_relaxed))
+                inclusiveMax.store (inclusive, std::memory_order_relaxed);
+        }
+
+        // 0 is the most recent paint, returns 0 if there's no such sample
+        [[nodiscard]] double getSample (int samplesAgo) const noexcept
+        {
+            auto count = numSamples.load (std::memory_order_acquire);
+            if (samplesAgo < 0 || samplesAgo >= historySize || (juce::uint64) samplesAgo >= count)
+                return 0.0;
+
+            return samples[(size_t) ((count - 1 - (juce::uint64) samplesAgo) % historySize)].load (std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] double getMax() const noexcept { return max.load (std::memory_order_relaxed); }
+
+        // covers every paint since creation or the last reset, not just the ring buffer
+        [[nodiscard]] double getPercentile (double percent) const noexcept { return histogram.getQuantile (percent / 100.0); }
+        [[nodiscard]] const PaintHistogram& getHistogram() const noexcept { return histogram; }
+
+        // these only cover the ring buffer, so slow paints from a while ago age out
+        [[nodiscard]] double getRecentMean() const noexcept
+        {
+            auto count = getNumRecentSamples();
+            if (count == 0)
+                return 0.0;
+
+            double sum = 0;
+            for (int i = 0; i < count; ++i)
+                sum += getSample (i);
+            return sum / (double) count;
+        }
+
+        [[nodiscard]] double getRecentPercentile (double percent) const noexcept
+        {
+            auto count = getNumRecentSamples();
+            if (count == 0)
+                return 0.0;
+
+            std::array<double, historySize> recent {};
+            for (int i = 0; i < count; ++i)
+                recent[(size_t) i] = getSample (i);
+
+            auto index = juce::jlimit (0, count - 1, (int) std::ceil (percent / 100.0 * (double) count) - 1);
+            std::nth_element (recent.begin(), recent.begin() + index, recent.begin() + count);
+            return recent[(size_t) index];
+        }
+
+        // our latest paint plus the latest paint of every timed descendant
+        // (including ones below untimed intermediate components)
+        [[nodiscard]] double getInclusiveSample() const noexcept { return getSample (0) + descendantsLast.load (std::memory_order_relaxed); }
+        [[nodiscard]] double getInclusiveMax() const noexcept { return inclusiveMax.load (std::memory_order_relaxed); }
+        [[nodiscard]] double getInclusivePercentile (double percent) const noexcept { return inclusiveHistogram.getQuantile (percent / 100.0); }
+
+        // number of timed ancestors
+        [[nodiscard]] int getDepth() const noexcept
+        {
+            int depth = 0;
+            for (auto* t = parent.get(); t != nullptr; t = t->parent.get())
+                ++depth;
+            return depth;
+        }
+
+        [[nodiscard]] juce::Component* getComponent() const noexcept { return component; }
+
+        // total paints recorded since creation or the last reset
+        [[nodiscard]] juce::uint64 getNumSamples() const noexcept { return numSamples.load (std::memory_order_acquire); }
+        [[nodiscard]] int getNumRecentSamples() const noexcept { return (int) juce::jmin ((juce::uint64) historySize, getNumSamples()); }
+
+        // bumped by every paint of this component or a timed descendant, never reset
+        [[nodiscard]] juce::uint64 getPaintGeneration() const noexcept { return paints.load (std::memory_order_acquire); }
+
+        // only call from the thread that paints the component
+        void reset() noexcept
+        {
+            bubble (parent.get(), -getSample (0));
+
+            for (auto& s : samples)
+                s.store (0.0, std::memory_order_relaxed);
+
+            max.store (0.0, std::memory_order_relaxed);
+            inclusiveMax.store (0.0, std::memory_order_relaxed);
+            histogram.reset();
+            inclusiveHistogram.reset();
+            numSamples.store (0, std::memory_order_release);
+        }
+
+    private:
+        juce::Component::SafePointer<juce::Component> component;
+        std::array<std::atomic<double>, historySize> samples {};
+        std::atomic<double> max { 0.0 };
+        std::atomic<juce::uint64> numSamples { 0 };
+        std::atomic<juce::uint64> paints { 0 };
+        PaintHistogram histogram;
+
+        // nearest timed ancestor and what it was resolved against
+        Ptr parent;
+        juce::Component* resolvedParentComponent = nullptr;
+        juce::uint32 resolvedGeneration = 0;
+
+        // sum of the latest sample of every timed descendant
+        std::atomic<double> descendantsLast { 0.0 };
+        std::atomic<double> inclusiveMax { 0.0 };
+        PaintHistogram inclusiveHistogram;
+
+        explicit ComponentTiming (juce::Component& c) : component (&c)
+        {
+            component->addComponentListener (this);
+        }
+
+        // also called when an untimed ancestor is moved, or when we're removed without being deleted
+        void componentParentHierarchyChanged (juce::Component&) override
+        {
+            detachFromParent();
+
+            // other records below the change might resolve to a different ancestor too
+            ++generation();
+        }
+
+        void detachFromParent()
+        {
+            bubble (parent.get(), -(getSample (0) + descendantsLast.load (std::memory_order_relaxed)));
+            parent = nullptr;
+            resolvedParentComponent = nullptr;
+        }
+
+        static std::atomic<juce::uint32>& generation()
+        {
+            static std::atomic<juce::uint32> g { 1 };
+            return g;
+        }
+
+        static void bubble (ComponentTiming* ancestor, double delta) noexcept
+        {
+            if (juce::exactlyEqual (delta, 0.0))
+                return;
+
+            for (; ancestor != nullptr; ancestor = ancestor->parent.get())
+                ancestor->descendantsLast.store (ancestor->descendantsLast.load (std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
+        // cheap when nothing changed: a parent pointer compare and an atomic load
+        void resolveParentIfNeeded()
+        {
+            auto* parentComponent = component != nullptr ? component->getParentComponent() : nullptr;
+            auto currentGeneration = generation().load (std::memory_order_relaxed);
+            if (parentComponent == resolvedParentComponent && currentGeneration == resolvedGeneration)
+                return;
+
+            resolvedParentComponent = parentComponent;
+            resolvedGeneration = currentGeneration;
+
+            ComponentTiming* nearest = nullptr;
+            for (auto* c = parentComponent; c != nullptr && nearest == nullptr; c = c->getParentComponent())
+                nearest = find (c);
+
+            if (nearest == parent.get())
+                return;
+
+            // move our contribution over to the new chain of ancestors
+            auto contribution = getSample (0) + descendantsLast.load (std::memory_order_relaxed);
+            bubble (parent.get(), -contribution);
+            parent = nearest;
+            bubble (parent.get(), contribution);
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComponentTiming)
+    };
+
     class ComponentTimer
     {
     public:
-        explicit ComponentTimer (juce::Component* c) : component (c)
+        explicit ComponentTimer (juce::Component* c) : ComponentTimer (ComponentTiming::forComponent (*c))
+        {
+        }
+
+        // use this if you hold onto the ComponentTiming, it skips the property lookup
+        explicit ComponentTimer (ComponentTiming& t) : timing (t)
         {
             startTimeTicks = juce::Time::getHighResolutionTicks();
         }
@@ -14,22 +346,17 @@ namespace melatonin
         ~ComponentTimer()
         {
             static double scalar = 1.0 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
-            result = static_cast<double> (juce::Time::getHighResolutionTicks() - startTimeTicks) * scalar;
-
-            auto& props = component->getProperties();
+            auto endTimeTicks = juce::Time::getHighResolutionTicks();
+            result = static_cast<double> (endTimeTicks - startTimeTicks) * scalar;
 
-            // if this new time is slower, make it the max
-            if (result > (double) props.getWithDefault ("timing1", 0.0))
-                props.set ("timingMax", result);
+            timing.addSample (result);
 
-            // push the 1st and 2nd timings down
-            props.set ("timing3", props.getWithDefault ("timing2", 0.0));
-            props.set ("timing2", props.getWithDefault ("timing1", 0.0));
-            props.set ("timing1", result);
+            if (PaintProfiler::isRecording())
+                PaintProfiler::getInstance().record (timing.getComponent(), startTimeTicks, endTimeTicks, timing.getDepth());
         }
 
     private:
-        juce::Component* component;
+        ComponentTiming& timing;
         juce::int64 startTimeTicks;
         double result = 0;
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComponentTimer)
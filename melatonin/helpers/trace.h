@@ -0,0 +1,361 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+#if defined(_MSC_VER)
+    #define MELATONIN_TRACE_FUNCTION __FUNCSIG__
+#else
+    #define MELATONIN_TRACE_FUNCTION __PRETTY_FUNCTION__
+#endif
+
+// Built-in trace backend for the TRACE_* macros when Perfetto isn't around
+// Events go into a per-thread buffer and are only touched when a session is recording.
+// Buffers are allocated by whoever starts the session and claimed by threads as they
+// record, so recording never allocates (threads that find none left drop their events).
+// Write the session out as Chrome Trace Event JSON, which opens in ui.perfetto.dev or chrome://tracing
+namespace melatonin::trace
+{
+    struct Event
+    {
+        const char* category = nullptr;
+        const char* name = nullptr;
+        juce::int64 startTicks = 0;
+        juce::int64 endTicks = 0;
+    };
+
+    // written only by its own thread, read by whoever writes the file
+    struct ThreadBuffer
+    {
+        static constexpr size_t capacity = 1 << 16;
+        static constexpr int maxOpenEvents = 64;
+
+        explicit ThreadBuffer (int id) : threadId (id)
+        {
+            events.resize (capacity);
+        }
+
+        const int threadId;
+
+        // set by the claiming thread, copying a juce::String doesn't allocate
+        juce::String threadName;
+        juce::Thread::ThreadID nativeThreadId = nullptr;
+        bool isMessageThread = false;
+
+        std::vector<Event> events;
+        std::atomic<size_t> numEvents { 0 };
+        std::atomic<juce::uint32> numDropped { 0 };
+        std::atomic<juce::uint32> session { 0 };
+
+        // TRACE_EVENT_BEGIN without a matching END yet
+        std::array<Event, maxOpenEvents> openEvents {};
+        int numOpen = 0;
+    };
+
+    class Tracer
+    {
+    public:
+        static Tracer& getInstance()
+        {
+            static Tracer instance;
+            return instance;
+        }
+
+        // one relaxed load, this is what every TRACE_* macro pays when not recording
+        static bool isRecording() noexcept
+        {
+            return recordingFlag().load (std::memory_order_relaxed);
+        }
+
+        ~Tracer()
+        {
+            for (auto& slot : slots)
+                delete slot.load (std::memory_order_relaxed);
+        }
+
+        // allocates the buffers that threads recording for the first time will claim
+        void start()
+        {
+            startTicks = juce::Time::getHighResolutionTicks();
+            numUnbuffered.store (0, std::memory_order_relaxed);
+
+            auto firstUnclaimed = numClaimed.load (std::memory_order_acquire);
+            for (auto i = firstUnclaimed; i < juce::jmin (maxThreads, firstUnclaimed + spareBuffers); ++i)
+                if (slots[(size_t) i].load (std::memory_order_acquire) == nullptr)
+                    slots[(size_t) i].store (new ThreadBuffer (i + 1), std::memory_order_release);
+
+            // buffers clear themselves the next time their thread records
+            session.fetch_add (1, std::memory_order_relaxed);
+            recordingFlag().store (true, std::memory_order_release);
+        }
+
+        void stop()
+        {
+            recordingFlag().store (false, std::memory_order_release);
+        }
+
+        void record (const Event& event) noexcept
+        {
+            auto* buffer = bufferForThisThread();
+            if (buffer == nullptr)
+                return;
+
+            auto count = buffer->numEvents.load (std::memory_order_relaxed);
+            if (count >= ThreadBuffer::capacity)
+            {
+                buffer->numDropped.fetch_add (1, std::memory_order_relaxed);
+                return;
+            }
+
+            buffer->events[count] = event;
+            buffer->numEvents.store (count + 1, std::memory_order_release);
+        }
+
+        // nullptr when every buffer allocated by start() was already claimed by other threads
+        ThreadBuffer* bufferForThisThread() noexcept
+        {
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (buffer == nullptr)
+                buffer = claimBufferForThisThread();
+
+            if (buffer == nullptr)
+            {
+                numUnbuffered.fetch_add (1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            auto currentSession = session.load (std::memory_order_relaxed);
+            if (buffer->session.load (std::memory_order_relaxed) != currentSession)
+            {
+                buffer->session.store (currentSession, std::memory_order_relaxed);
+                buffer->numEvents.store (0, std::memory_order_release);
+                buffer->numDropped.store (0, std::memory_order_relaxed);
+                buffer->numOpen = 0;
+            }
+
+            return buffer;
+        }
+
+        // call after stop(), writes to a temporary file first so a failed write never leaves half a trace
+        bool writeJson (const juce::File& file)
+        {
+            juce::TemporaryFile temp (file);
+            {
+                juce::FileOutputStream out (temp.getFile());
+                if (out.failedToOpen())
+                    return false;
+
+                writeJson (out);
+                out.flush();
+                if (out.getStatus().failed())
+                    return false;
+            }
+
+            return temp.overwriteTargetFileWithTemporary();
+        }
+
+        void writeJson (juce::OutputStream& out)
+        {
+            auto currentSession = session.load (std::memory_order_relaxed);
+            auto ticksPerMicro = (double) juce::Time::getHighResolutionTicksPerSecond() / 1e6;
+            bool first = true;
+
+            auto separator = [&] {
+                out << (first ? "\n" : ",\n");
+                first = false;
+            };
+
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+            auto claimed = numClaimed.load (std::memory_order_acquire);
+            for (int slot = 0; slot < claimed; ++slot)
+            {
+                auto* buffer = slots[(size_t) slot].load (std::memory_order_acquire);
+                if (buffer->session.load (std::memory_order_relaxed) != currentSession)
+                    continue;
+
+                auto threadName = buffer->threadName;
+                if (buffer->isMessageThread)
+                    threadName = "Message Thread";
+                else if (threadName.isEmpty())
+                    threadName = "Thread " + juce::String::toHexString ((juce::pointer_sized_int) buffer->nativeThreadId);
+                separator();
+                out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->threadId
+                    << ",\"args\":{\"name\":\"" << juce::JSON::escapeString (threadName) << "\"}}";
+
+                auto count = buffer->numEvents.load (std::memory_order_acquire);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto& event = buffer->events[i];
+                    separator();
+                    out << "{\"ph\":\"X\",\"cat\":\"" << juce::JSON::escapeString (event.category)
+                        << "\",\"name\":\"" << juce::JSON::escapeString (readableName (event.name))
+                        << "\",\"pid\":1,\"tid\":" << buffer->threadId
+                        << ",\"ts\":" << juce::String ((double) (event.startTicks - startTicks) / ticksPerMicro, 3)
+                        << ",\"dur\":" << juce::String ((double) (event.endTicks - event.startTicks) / ticksPerMicro, 3) << "}";
+                }
+
+                // the buffer filled up, the trace is missing the end of this thread's session
+                if (auto dropped = buffer->numDropped.load (std::memory_order_relaxed))
+                {
+                    separator();
+                    out << "{\"ph\":\"M\",\"name\":\"dropped_events\",\"pid\":1,\"tid\":" << buffer->threadId
+                        << ",\"args\":{\"count\":" << (int) dropped << "}}";
+                }
+            }
+
+            // from threads that started recording after every buffer was claimed
+            if (auto unbuffered = numUnbuffered.load (std::memory_order_relaxed))
+            {
+                separator();
+                out << "{\"ph\":\"M\",\"name\":\"dropped_events\",\"pid\":1,\"args\":{\"count\":" << (int) unbuffered
+                    << ",\"reason\":\"no buffer left for the thread\"}}";
+            }
+
+            out << "\n]}\n";
+        }
+
+    private:
+        static constexpr int maxThreads = 32;
+
+        // unclaimed buffers kept ready for threads that haven't recorded yet, each is ~2MB
+        static constexpr int spareBuffers = 4;
+
+        // slots below numClaimed belong to a thread, the rest may hold a buffer from start()
+        std::array<std::atomic<ThreadBuffer*>, maxThreads> slots {};
+        std::atomic<int> numClaimed { 0 };
+        std::atomic<juce::uint32> numUnbuffered { 0 };
+        std::atomic<juce::uint32> session { 0 };
+        juce::int64 startTicks = 0;
+
+        Tracer() = default;
+
+        static std::atomic<bool>& recordingFlag()
+        {
+            static std::atomic<bool> flag { false };
+            return flag;
+        }
+
+        // once per thread, lock free and without allocating, so it's fine on the audio thread
+        ThreadBuffer* claimBufferForThisThread() noexcept
+        {
+            auto index = numClaimed.load (std::memory_order_acquire);
+            ThreadBuffer* buffer = nullptr;
+            do
+            {
+                if (index >= maxThreads)
+                    return nullptr;
+
+                buffer = slots[(size_t) index].load (std::memory_order_acquire);
+                if (buffer == nullptr)
+                    return nullptr;
+            } while (!numClaimed.compare_exchange_weak (index, index + 1, std::memory_order_acq_rel));
+
+            auto* messageManager = juce::MessageManager::getInstanceWithoutCreating();
+            buffer->isMessageThread = messageManager != nullptr && messageManager->isThisTheMessageThread();
+            if (auto* thread = juce::Thread::getCurrentThread())
+                buffer->threadName = thread->getThreadName();
+
+            buffer->nativeThreadId = juce::Thread::getCurrentThreadId();
+            return buffer;
+        }
+
+        // "void melatonin::Preview::paint(juce::Graphics &)" -> "melatonin::Preview::paint"
+        static juce::String readableName (const char* name)
+        {
+            auto s = juce::String (name);
+            if (s.containsChar ('('))
+            {
+                s = s.upToFirstOccurrenceOf ("(", false, false);
+                s = s.fromLastOccurrenceOf (" ", false, false);
+            }
+            return s;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (Tracer)
+    };
+
+    // what TRACE_COMPONENT and TRACE_EVENT expand to, any perfetto style args are ignored
+    class ScopedEvent
+    {
+    public:
+        template <typename... Args>
+        ScopedEvent (const char* category, const char* name, Args&&...) noexcept
+        {
+            if (Tracer::isRecording())
+                event = { category, name, juce::Time::getHighResolutionTicks(), 0 };
+        }
+
+        ~ScopedEvent()
+        {
+            if (event.name != nullptr && Tracer::isRecording())
+            {
+                event.endTicks = juce::Time::getHighResolutionTicks();
+                Tracer::getInstance().record (event);
+            }
+        }
+
+    private:
+        Event event;
+        JUCE_DECLARE_NON_COPYABLE (ScopedEvent)
+    };
+
+    template <typename... Args>
+    void begin (const char* category, const char* name, Args&&...) noexcept
+    {
+        if (!Tracer::isRecording())
+            return;
+
+        auto* buffer = Tracer::getInstance().bufferForThisThread();
+        if (buffer == nullptr)
+            return;
+
+        if (buffer->numOpen < ThreadBuffer::maxOpenEvents)
+            buffer->openEvents[(size_t) buffer->numOpen] = { category, name, juce::Time::getHighResolutionTicks(), 0 };
+
+        // keep counting past the limit so begin/end stay paired
+        ++buffer->numOpen;
+    }
+
+    inline void end (const char* /*category*/) noexcept
+    {
+        if (!Tracer::isRecording())
+            return;
+
+        auto& tracer = Tracer::getInstance();
+        auto* buffer = tracer.bufferForThisThread();
+
+        // the matching begin happened before recording started
+        if (buffer == nullptr || buffer->numOpen == 0)
+            return;
+
+        if (--buffer->numOpen < ThreadBuffer::maxOpenEvents)
+        {
+            auto event = buffer->openEvents[(size_t) buffer->numOpen];
+            event.endTicks = juce::Time::getHighResolutionTicks();
+            tracer.record (event);
+        }
+    }
+
+    // convenience for headless runs, records until the returned object is destroyed
+    class ScopedSession
+    {
+    public:
+        explicit ScopedSession (juce::File f) : file (std::move (f))
+        {
+            Tracer::getInstance().start();
+        }
+
+        ~ScopedSession()
+        {
+            auto& tracer = Tracer::getInstance();
+            tracer.stop();
+            tracer.writeJson (file);
+        }
+
+    private:
+        juce::File file;
+        JUCE_DECLARE_NON_COPYABLE (ScopedSession)
+    };
+}
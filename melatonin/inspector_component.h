@@ -1,11 +1,14 @@
 #pragma once
 
 #include "components/inspector_image_button.h"
+#include "helpers/component_search_index.h"
 #include "helpers/misc.h"
 #include "melatonin_inspector/melatonin/components/accesibility.h"
 #include "melatonin_inspector/melatonin/components/box_model.h"
 #include "melatonin_inspector/melatonin/components/color_picker.h"
 #include "melatonin_inspector/melatonin/components/component_tree_view_item.h"
+#include "melatonin_inspector/melatonin/components/inspector_cost_view.h"
+#include "melatonin_inspector/melatonin/components/paint_profiler_view.h"
 #include "melatonin_inspector/melatonin/components/preview.h"
 #include "melatonin_inspector/melatonin/components/properties.h"
 #include "melatonin_inspector/melatonin/lookandfeel.h"
@@ -50,6 +53,8 @@ namespace melatonin
             addChildComponent (preview);
             addChildComponent (properties);
             addChildComponent (accessibility);
+            addChildComponent (paintProfiler);
+            addChildComponent (inspectorCost);
 
             // z-order on panels is higher so they are clickable
             addAndMakeVisible (boxModelPanel);
@@ -57,6 +62,8 @@ namespace melatonin
             addAndMakeVisible (previewPanel);
             addAndMakeVisible (propertiesPanel);
             addAndMakeVisible (accessibilityPanel);
+            addAndMakeVisible (paintProfilerPanel);
+            addAndMakeVisible (inspectorCostPanel);
 
             addAndMakeVisible (searchBox);
             addAndMakeVisible (searchIcon);
@@ -76,6 +83,16 @@ namespace melatonin
                 }
             };
 
+            paintProfiler.selectComponentCallback = [this] (Component* c) {
+                if (selectComponentCallback)
+                    selectComponentCallback (c);
+            };
+
+            paintProfiler.heatmapCallback = [this] (bool enabled, bool useMean) {
+                if (toggleHeatmapCallback)
+                    toggleHeatmapCallback (enabled, useMean);
+            };
+
             emptySelectionPrompt.setJustificationType (juce::Justification::centredTop);
             emptySearchLabel.setJustificationType (juce::Justification::centredTop);
             emptySearchLabel.setColour (juce::Label::textColourId, colors::treeItemTextSelected);
@@ -94,12 +111,13 @@ namespace melatonin
             searchBox.setColour (juce::TextEditor::outlineColourId, juce::Colours::transparentBlack);
             searchBox.setColour (juce::TextEditor::focusedOutlineColourId, juce::Colours::transparentBlack);
             searchBox.setTextToShowWhenEmpty ("Filter components...", colors::searchText);
+            searchIndex.onNumComponentsChanged = [this] (int numComponents) {
+                searchBox.setTextToShowWhenEmpty (juce::String ("Filter " + juce::String (numComponents) + " components..."), colors::searchText);
+            };
             searchBox.setJustification (juce::Justification::centredLeft);
             searchBox.onEscapeKey = [&] {
                 searchBox.setText ("");
                 searchBox.giveAwayKeyboardFocus();
-                lastSearchText = {};
-                getRoot()->validateSubItems();
             };
 
             logo.onClick = []() { juce::URL ("https://github.com/sudara/melatonin_inspector/").launchInDefaultBrowser(); };
@@ -115,38 +133,7 @@ namespace melatonin
 
             
             searchBox.onTextChange = [this] {
-                auto searchText = searchBox.getText();
-                ensureTreeIsConstructed();
-
-                if (lastSearchText.isNotEmpty() && !searchText.startsWith (lastSearchText))
-                {
-                    getRoot()->validateSubItems();
-                }
-
-                lastSearchText = searchText;
-
-                // try to find the first item that matches the search string
-                if (searchText.isNotEmpty())
-                {
-                    getRoot()->filterNodesRecursively (searchText);
-                }
-
-                // display empty label
-                if (getRoot()->getNumSubItems() == 0
-                    && !searchText.containsIgnoreCase (getRoot()->getComponentName())
-                    && tree.getNumSelectedItems() == 0)
-                {
-                    tree.setVisible (false);
-                    emptySearchLabel.setVisible (true);
-
-                    resized();
-                }
-                else
-                {
-                    tree.setVisible (true);
-                    emptySearchLabel.setVisible (false);
-                }
-
+                filterTree (searchBox.getText());
                 clearButton.setVisible (searchBox.getText().isNotEmpty());
             };
 
@@ -193,6 +180,9 @@ namespace melatonin
         {
             root = &r;
             colorPicker.setRootComponent (root);
+            paintProfiler.setRoot (root);
+            searchIndex.setRoot (root);
+            searchFilter = {};
 
             tree.setRootItem (nullptr);
             rootItem = nullptr;
@@ -205,6 +195,8 @@ namespace melatonin
         {
             root = nullptr;
             colorPicker.setRootComponent (nullptr);
+            paintProfiler.setRoot (nullptr);
+            searchIndex.setRoot (nullptr);
         }
 
         void paint (juce::Graphics& g) override
@@ -239,17 +231,74 @@ namespace melatonin
                 tree.setRootItem (nullptr);
 
             // construct the root item
-            rootItem = std::make_unique<ComponentTreeViewItem> (root, outlineComponentCallback, selectComponentCallback);
+            rootItem = std::make_unique<ComponentTreeViewItem> (root, outlineComponentCallback, selectComponentCallback, &treeUpdates, &searchFilter);
             tree.setRootItem (rootItem.get());
             getRoot()->setOpenness (ComponentTreeViewItem::Openness::opennessOpen);
 
             tree.setVisible (true);
-            auto numComponents = getRoot()->countItemsRecursively();
-            searchBox.setTextToShowWhenEmpty (juce::String ("Filter " + juce::String (numComponents) + " components..."), colors::searchText);
+
+            startCountingComponents();
 
             resized();
         }
 
+        // counting means visiting every component, so the search index does it once the tree is up
+        // and keeps the count current from then on, the index itself waits for the first search
+        void startCountingComponents()
+        {
+            if (searchIndex.isCounting())
+                return;
+
+            searchBox.setTextToShowWhenEmpty ("Filter components...", colors::searchText);
+            juce::MessageManager::callAsync ([safeThis = juce::Component::SafePointer<InspectorComponent> (this)] {
+                if (safeThis && safeThis->inspectorEnabled)
+                    safeThis->searchIndex.startCounting();
+            });
+        }
+
+        // shows only the components matching the search (and their ancestors), an empty search shows everything
+        void filterTree (const juce::String& searchText)
+        {
+            TRACE_COMPONENT();
+
+            ensureTreeIsConstructed();
+            treeUpdates.flush();
+
+            // the tree keeps all its items, the filter just decides which are shown
+            searchFilter.active = searchText.isNotEmpty();
+            searchFilter.visible.clear();
+
+            if (searchFilter.active)
+            {
+                for (auto* match : searchIndex.search (searchText))
+                {
+                    // stop climbing once we reach an ancestor we've already added
+                    for (auto* c = match; c != nullptr; c = c->getParentComponent())
+                        if (!searchFilter.visible.insert (c).second || c == root)
+                            break;
+                }
+
+                // try to find the first item that matches the search string
+                getRoot()->revealSearchResults (searchText);
+            }
+
+            getRoot()->treeHasChanged();
+
+            // display empty label
+            if (searchFilter.active && searchFilter.visible.empty() && tree.getNumSelectedItems() == 0)
+            {
+                tree.setVisible (false);
+                emptySearchLabel.setVisible (true);
+
+                resized();
+            }
+            else
+            {
+                tree.setVisible (true);
+                emptySearchLabel.setVisible (false);
+            }
+        }
+
         void repositionOnRight( juce::Rectangle<int> &toolbar, Component &comp, int fromRight ) {
             comp.setTopLeftPosition (toolbar.removeFromRight (fromRight).getX(), toolbar.getCentreY()-comp.getHeight()/2);
         }
@@ -285,13 +334,13 @@ namespace melatonin
             boxModelPanel.setBounds (mainCol.removeFromTop (32));
             boxModel.setBounds (mainCol.removeFromTop (boxModel.isVisible() ? 280 : 0));
 
-            auto previewHeight = (preview.showsPerformanceTimings()) ? 182 : 132;
+            auto previewHeight = (preview.showsPerformanceTimings()) ? 198 : 132;
             auto previewBounds = mainCol.removeFromTop (preview.isVisible() ? previewHeight : 32);
             preview.setBounds (previewBounds);
             previewPanel.setBounds (previewBounds.removeFromTop (32).removeFromLeft (200));
 
             // the picker icon + rgba toggle overlays the panel header, so we overlap it
-            auto colorPickerHeight = 72;
+            auto colorPickerHeight = 72 + colorPicker.getRegionStatsHeight();
             int numColorsToDisplay = juce::jlimit (0, properties.isVisible() ? 12 : 3, (int) model.colors.size());
             if (colorPicker.isVisible() && !model.colors.empty())
                 colorPickerHeight += 24 * numColorsToDisplay;
@@ -302,6 +351,12 @@ namespace melatonin
             accessibilityPanel.setBounds (mainCol.removeFromTop (32));
             accessibility.setBounds (mainCol.removeFromTop (accessibility.isVisible() ? 110 : 0).withTrimmedLeft (32));
 
+            paintProfilerPanel.setBounds (mainCol.removeFromTop (32));
+            paintProfiler.setBounds (mainCol.removeFromTop (paintProfiler.isVisible() ? 160 : 0).withTrimmedLeft (32));
+
+            inspectorCostPanel.setBounds (mainCol.removeFromTop (32));
+            inspectorCost.setBounds (mainCol.removeFromTop (inspectorCost.isVisible() ? InspectorCostView::preferredHeight : 0).withTrimmedLeft (32));
+
             propertiesPanel.setBounds (mainCol.removeFromTop (33)); // extra pixel for divider
             properties.setBounds (mainCol.withTrimmedLeft (32));
 
@@ -335,6 +390,8 @@ namespace melatonin
                 // Selects and highlights
                 if (component && getRoot())
                 {
+                    treeUpdates.flush();
+
                     if (collapseTreeBeforeSelection)
                         getRoot()->recursivelyCloseSubItems();
 
@@ -401,6 +458,8 @@ namespace melatonin
             previewPanel.setVisible (nowEnabled);
             colorPickerPanel.setVisible (nowEnabled);
             propertiesPanel.setVisible (nowEnabled);
+            paintProfilerPanel.setVisible (nowEnabled);
+            inspectorCostPanel.setVisible (nowEnabled);
             tree.setVisible (nowEnabled);
 
             if (!nowEnabled)
@@ -408,11 +467,19 @@ namespace melatonin
                 model.deselectComponent();
                 if (getRoot())
                     getRoot()->recursivelyCloseSubItems();
+
+                // stop listening to the whole app while disabled
+                searchIndex.setRoot (nullptr);
             }
+            else
+            {
+                searchIndex.setRoot (root);
+                startCountingComponents();
 
-            // populate the tree view if nothing selected
-            else if (selectedComponent == nullptr)
-                ensureTreeIsConstructed();
+                // populate the tree view if nothing selected
+                if (selectedComponent == nullptr)
+                    ensureTreeIsConstructed();
+            }
 
             colorPicker.reset();
 
@@ -447,6 +514,7 @@ namespace melatonin
         std::function<void (bool enabled)> toggleSelectionMode;
         std::function<void (bool enabled)> toggleDragEnabledCallback;
         std::function<void (bool enabled)> toggleLockCallback;
+        std::function<void (bool enabled, bool useMean)> toggleHeatmapCallback;
 
     private:
         Component::SafePointer<Component> selectedComponent;
@@ -476,6 +544,12 @@ namespace melatonin
         Accessibility accessibility { model };
         CollapsablePanel accessibilityPanel { "ACCESSIBILITY", &accessibility, false };
 
+        PaintProfilerView paintProfiler;
+        CollapsablePanel paintProfilerPanel { "PAINT PROFILER", &paintProfiler, false, false };
+
+        InspectorCostView inspectorCost;
+        CollapsablePanel inspectorCostPanel { "INSPECTOR COST", &inspectorCost, false, false };
+
         // TODO: move to its own component
         juce::TreeView tree;
         juce::Label emptySelectionPrompt { "SelectionPrompt", "Select any component to see components tree" };
@@ -489,8 +563,11 @@ namespace melatonin
         InspectorImageButton fpsToggle { "speedometer", { 2, 7 }, true };
         InspectorImageButton tabToggle { "tab", { 1, 6 }, true };
 
-        juce::String lastSearchText;
+        ComponentSearchIndex searchIndex;
 
+        // must outlive the tree items
+        TreeUpdateScheduler treeUpdates;
+        TreeSearchFilter searchFilter;
         std::unique_ptr<ComponentTreeViewItem> rootItem;
 
         ComponentTreeViewItem* getRoot() const
@@ -174,6 +174,12 @@ namespace melatonin
             }
         }
 
+        // property panels only name their sections so they can be opened and closed
+        int getPropertyPanelSectionHeaderHeight (const juce::String&) override
+        {
+            return 0;
+        }
+
         void drawTextEditorOutline (juce::Graphics& g, int width, int height, juce::TextEditor& textEditor) override
         {
             if (dynamic_cast<juce::AlertWindow*> (textEditor.getParentComponent()) == nullptr)
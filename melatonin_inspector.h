@@ -15,14 +15,29 @@ END_JUCE_MODULE_DECLARATION
 #pragma once
 
 #ifndef PERFETTO
-    #define TRACE_COMPONENT(...)
-    #define TRACE_EVENT(category, ...)
-    #define TRACE_EVENT_BEGIN(category, ...)
-    #define TRACE_EVENT_END(category)
+    // opt in with MELATONIN_TRACE=1, otherwise the TRACE_* macros stay no-ops
+    // the built-in tracer keeps event names as pointers, so they must be string literals
+    #ifndef MELATONIN_TRACE
+        #define MELATONIN_TRACE 0
+    #endif
+
+    #if MELATONIN_TRACE
+        #include "melatonin_inspector/melatonin/helpers/trace.h"
+        #define TRACE_COMPONENT(...) melatonin::trace::ScopedEvent JUCE_JOIN_MACRO (melatoninTrace, __LINE__) ("component", MELATONIN_TRACE_FUNCTION)
+        #define TRACE_EVENT(category, ...) melatonin::trace::ScopedEvent JUCE_JOIN_MACRO (melatoninTrace, __LINE__) (category, __VA_ARGS__)
+        #define TRACE_EVENT_BEGIN(category, ...) melatonin::trace::begin (category, __VA_ARGS__)
+        #define TRACE_EVENT_END(category) melatonin::trace::end (category)
+    #else
+        #define TRACE_COMPONENT(...)
+        #define TRACE_EVENT(category, ...)
+        #define TRACE_EVENT_BEGIN(category, ...)
+        #define TRACE_EVENT_END(category)
+    #endif
 #endif
 
 #include "melatonin/lookandfeel.h"
 #include "melatonin_inspector/melatonin/components/overlay.h"
+#include "melatonin_inspector/melatonin/helpers/component_spatial_index.h"
 #include "melatonin_inspector/melatonin/helpers/inspector_settings.h"
 #include "melatonin_inspector/melatonin/helpers/overlay_mouse_listener.h"
 #include "melatonin_inspector/melatonin/inspector_component.h"
@@ -69,6 +84,12 @@ namespace melatonin
         explicit Inspector (juce::Component& rootComponent, bool inspectorEnabledAtStart = true)
             : juce::DocumentWindow ("Melatonin Inspector", colors::background, 7, true)
         {
+#if !defined(PERFETTO) && MELATONIN_TRACE
+            // lets headless runs capture a trace without touching code
+            auto traceFile = juce::SystemStats::getEnvironmentVariable ("MELATONIN_TRACE_FILE", {});
+            if (traceFile.isNotEmpty())
+                traceSession = std::make_unique<trace::ScopedSession> (juce::File::getCurrentWorkingDirectory().getChildFile (traceFile));
+#endif
             TRACE_COMPONENT();
             this->addKeyListener (&keyListener);
 
@@ -104,6 +125,7 @@ namespace melatonin
                 juce::Desktop::getInstance().removeFocusChangeListener (this);
 
             // needed, otherwise removing look and feel will save bounds
+            settings->flush();
             settings->props.reset();
             setLookAndFeel (nullptr);
         }
@@ -124,6 +146,7 @@ namespace melatonin
             root->setWantsKeyboardFocus (true);
 
             fpsMeter.setRoot (*root);
+            spatialIndex.setRoot (root);
             overlayMouseListener.setRoot (*root);
             inspectorComponent.setRoot (*root);
         }
@@ -137,6 +160,7 @@ namespace melatonin
             root->removeComponentListener (this);
 
             fpsMeter.clearRoot();
+            spatialIndex.setRoot (nullptr);
             overlayMouseListener.clearRoot();
             inspectorComponent.clearRoot();
         }
@@ -157,6 +181,7 @@ namespace melatonin
 
         // this is a bit brittle and called a bit too frequently
         // for example 4-5 times on construction
+        // unchanged values are ignored and writes are batched by InspectorSettings
         void saveBounds()
         {
             TRACE_COMPONENT();
@@ -174,8 +199,6 @@ namespace melatonin
                 settings->props->setValue ("inspectorEnabledWidth", getWidth());
                 settings->props->setValue ("inspectorEnabledHeight", getHeight());
             }
-
-            settings->saveIfNeeded();
         }
 
         void restoreBoundsIfNeeded()
@@ -215,7 +238,7 @@ namespace melatonin
             inspectorComponent.setBounds (getLocalBounds());
         }
 
-        void outlineComponent (Component* c)
+        void outlineComponent (Component* c, bool showInfo = true)
         {
             TRACE_COMPONENT();
 
@@ -224,6 +247,18 @@ namespace melatonin
                 return;
 
             overlay.outlineComponent (c);
+            if (showInfo)
+                inspectorComponent.displayComponentInfo (c, true);
+        }
+
+        // the expensive half of hovering, once the mouse has settled
+        void hoverComponent (Component* c)
+        {
+            TRACE_COMPONENT();
+
+            if (!inspectorEnabled || overlay.isParentOf (c) || selectionLock)
+                return;
+
             inspectorComponent.displayComponentInfo (c, true);
         }
 
@@ -323,6 +358,7 @@ namespace melatonin
             {
                 clearSelections();
                 overlayMouseListener.disable();
+                spatialIndex.release();
             }
         }
 
@@ -344,6 +380,9 @@ namespace melatonin
         std::function<void()> onClose;
 
     private:
+#if !defined(PERFETTO) && MELATONIN_TRACE
+        std::unique_ptr<trace::ScopedSession> traceSession;
+#endif
         juce::SharedResourcePointer<InspectorSettings> settings;
         InspectorLookAndFeel inspectorLookAndFeel;
         InspectorComponent inspectorComponent;
@@ -353,6 +392,7 @@ namespace melatonin
         Overlay overlay;
         FPSMeter fpsMeter;
         OverlayMouseListener overlayMouseListener;
+        ComponentSpatialIndex spatialIndex;
         InspectorKeyCommands keyListener { *this };
         bool rootFollowsComponentUnderMouse = false;
 
@@ -411,7 +451,8 @@ namespace melatonin
 
         void setupCallbacks()
         {
-            overlayMouseListener.outlineComponentCallback = [this] (Component* c) { this->outlineComponent (c); };
+            overlayMouseListener.outlineComponentCallback = [this] (Component* c) { this->outlineComponent (c, false); };
+            overlayMouseListener.hoverComponentCallback = [this] (Component* c) { this->hoverComponent (c); };
             overlayMouseListener.outlineDistanceCallback = [this] (Component* c) { this->outlineDistanceCallback (c); };
             overlayMouseListener.selectComponentCallback = [this] (Component* c) { this->selectComponent (c, true); };
             overlayMouseListener.componentStartDraggingCallback = [this] (Component* c, const juce::MouseEvent& e) { this->startDragComponent (c, e); };
@@ -424,7 +465,7 @@ namespace melatonin
                     MouseEvent e_ = e.getEventRelativeTo(parent);
                     if (parent->contains( e_.position ))
                     {
-                        auto *newParent = getComponentAtExclude( parent, e_.position, c );
+                        auto *newParent = spatialIndex.getComponentAt( parent, e_.position, c );
                         if (newParent)
                         {
                             parent = newParent;
@@ -446,6 +487,8 @@ namespace melatonin
                     }
                 }
             };
+            // the index listens to every component, only keep it around while dragging
+            overlayMouseListener.componentDragEndedCallback = [this] { spatialIndex.release(); };
             overlayMouseListener.mouseExitCallback = [this] { if (this->inspectorEnabled) inspectorComponent.redisplaySelectedComponent(); };
 
             inspectorComponent.selectComponentCallback = [this] (Component* c) { this->selectComponent (c, false); };
@@ -465,6 +508,9 @@ namespace melatonin
             inspectorComponent.toggleDragEnabledCallback = [this] (const bool enable) { this->setDraggingEnabled (enable); };
             inspectorComponent.toggleSelectionMode = [this] (const bool enable) { this->setSelectionMode (enable ? FOLLOWS_FOCUS : FOLLOWS_MOUSE); };
             inspectorComponent.toggleLockCallback = [this] (const bool enable) { this->setSelectionLock (enable); };
+            inspectorComponent.toggleHeatmapCallback = [this] (const bool enable, const bool useMean) {
+                overlay.showHeatmap (enable, useMean ? PaintHeatmap::Metric::mean : PaintHeatmap::Metric::p95);
+            };
         }
 
         enum SelectionMode {
@@ -502,7 +548,6 @@ namespace melatonin
             }
 
             settings->props->setValue ("inspectorSelectionMode", selectionMode);
-            settings->saveIfNeeded();
         }
 
         void setDraggingEnabled (const bool enable)
@@ -520,7 +565,10 @@ namespace melatonin
         void restoreStateFromProps()
         {
             setDraggingEnabled (settings->props->getBoolValue ("enableDragging", false));
+            overlayMouseListener.setHoverDwellTime (settings->props->getIntValue ("hoverDwellMs", 120));
             setSelectionMode (static_cast<SelectionMode> (settings->props->getIntValue ("inspectorSelectionMode", FOLLOWS_MOUSE)));
+            overlay.showHeatmap (settings->props->getBoolValue ("showHeatmap", false),
+                settings->props->getValue ("heatmapMetric", "p95") == "mean" ? PaintHeatmap::Metric::mean : PaintHeatmap::Metric::p95);
         }
     };
 }
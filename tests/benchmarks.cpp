@@ -0,0 +1,308 @@
+#include <melatonin_inspector/melatonin_inspector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Times the inspector's hot paths on synthetic hierarchies, without a window or a running message loop
+//
+//   melatonin_inspector_benchmarks [--sizes 1000,10000,50000] [--iterations 20] [--output results.json]
+//
+// Results are written as JSON (to stdout by default) so they can be compared commit to commit.
+
+namespace
+{
+    // paints something, so snapshots do real work
+    class Node : public juce::Component
+    {
+    public:
+        explicit Node (juce::Colour c) : colour (c) {}
+
+        void paint (juce::Graphics& g) override
+        {
+            g.setColour (colour);
+            g.fillRect (getLocalBounds().reduced (1));
+        }
+
+    private:
+        juce::Colour colour;
+    };
+
+    struct Shape
+    {
+        const char* name;
+        int fanOut;
+    };
+
+    // wide and shallow, typical, deep and narrow
+    const Shape shapes[] = { { "wide", 64 }, { "balanced", 8 }, { "deep", 2 } };
+
+    struct Hierarchy
+    {
+        std::unique_ptr<juce::Component> root;
+        std::vector<std::unique_ptr<juce::Component>> nodes; // everything but the root, parents first
+        std::vector<juce::Component*> all;
+        int depth = 0;
+    };
+
+    // breadth first, each parent gets fanOut children laid out in a grid until there are numNodes in total
+    Hierarchy buildHierarchy (int numNodes, int fanOut)
+    {
+        Hierarchy h;
+        h.root = std::make_unique<Node> (juce::Colours::darkgrey);
+        h.root->setBounds (0, 0, 1200, 800);
+        h.all.push_back (h.root.get());
+
+        std::vector<int> depths { 0 };
+        juce::Random random (42);
+        auto columns = juce::jmax (1, juce::roundToInt (std::ceil (std::sqrt ((double) fanOut))));
+
+        for (size_t parentIndex = 0; (int) h.all.size() < numNodes; ++parentIndex)
+        {
+            auto* parent = h.all[parentIndex];
+            auto cellWidth = juce::jmax (8, parent->getWidth() / columns);
+            auto cellHeight = juce::jmax (8, parent->getHeight() / columns);
+
+            for (int i = 0; i < fanOut && (int) h.all.size() < numNodes; ++i)
+            {
+                // a few labels, so searches have more than one kind of match
+                std::unique_ptr<juce::Component> child;
+                if (i % 7 == 0)
+                    child = std::make_unique<juce::Label> (juce::String(), "text");
+                else
+                    child = std::make_unique<Node> (juce::Colour ((juce::uint32) random.nextInt()).withAlpha (1.0f));
+
+                child->setName ("node " + juce::String (h.all.size()));
+                child->setBounds ((i % columns) * cellWidth, (i / columns) * cellHeight, cellWidth, cellHeight);
+                parent->addAndMakeVisible (child.get());
+
+                depths.push_back (depths[parentIndex] + 1);
+                h.depth = juce::jmax (h.depth, depths.back());
+                h.all.push_back (child.get());
+                h.nodes.push_back (std::move (child));
+            }
+        }
+
+        return h;
+    }
+
+    double millisecondsSince (juce::int64 start)
+    {
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) * 1000.0;
+    }
+
+    // runs setup (untimed) then body (timed) the requested number of times
+    juce::var measure (int iterations, const std::function<void()>& setup, const std::function<void()>& body)
+    {
+        std::vector<double> samples;
+        for (int i = 0; i < iterations; ++i)
+        {
+            if (setup)
+                setup();
+
+            auto start = juce::Time::getHighResolutionTicks();
+            body();
+            samples.push_back (millisecondsSince (start));
+        }
+
+        std::sort (samples.begin(), samples.end());
+        double sum = 0;
+        for (auto sample : samples)
+            sum += sample;
+
+        auto result = std::make_unique<juce::DynamicObject>();
+        result->setProperty ("iterations", iterations);
+        result->setProperty ("mean_ms", sum / (double) samples.size());
+        result->setProperty ("median_ms", samples[samples.size() / 2]);
+        result->setProperty ("min_ms", samples.front());
+        result->setProperty ("max_ms", samples.back());
+        return result.release();
+    }
+
+    // the components picked for selection benchmarks, the same for every run
+    std::vector<juce::Component*> pickComponents (const Hierarchy& h, int count)
+    {
+        juce::Random random (7);
+        std::vector<juce::Component*> picked;
+        for (int i = 0; i < count; ++i)
+            picked.push_back (h.all[(size_t) random.nextInt ((int) h.all.size())]);
+        return picked;
+    }
+
+    void openAll (melatonin::ComponentTreeViewItem& item)
+    {
+        item.setOpen (true);
+        for (int i = 0; i < item.getNumSubItems(); ++i)
+            if (auto* child = dynamic_cast<melatonin::ComponentTreeViewItem*> (item.getSubItem (i)))
+                openAll (*child);
+    }
+
+    void forEachItem (melatonin::ComponentTreeViewItem& item, const std::function<void (melatonin::ComponentTreeViewItem&)>& callback)
+    {
+        callback (item);
+        for (int i = 0; i < item.getNumSubItems(); ++i)
+            if (auto* child = dynamic_cast<melatonin::ComponentTreeViewItem*> (item.getSubItem (i)))
+                forEachItem (*child, callback);
+    }
+
+    juce::var runHierarchy (int numNodes, const Shape& shape, int iterations)
+    {
+        auto h = buildHierarchy (numNodes, shape.fanOut);
+        auto picked = pickComponents (h, iterations);
+        auto results = std::make_unique<juce::DynamicObject>();
+        auto noop = [] (juce::Component*) {};
+
+        // the tree's root item and its first level, as seen when the inspector opens
+        {
+            melatonin::InspectorComponent inspector;
+            inspector.selectComponentCallback = noop;
+            inspector.outlineComponentCallback = noop;
+            inspector.setSize (380, 800);
+
+            results->setProperty ("ensureTreeIsConstructed",
+                measure (iterations, [&] { inspector.setRoot (*h.root); }, [&] { inspector.ensureTreeIsConstructed(); }));
+
+            // the first search builds the index
+            results->setProperty ("filterTreeCold",
+                measure (iterations, [&] { inspector.setRoot (*h.root); inspector.ensureTreeIsConstructed(); }, [&] { inspector.filterTree ("node 1"); }));
+
+            int query = 0;
+            const juce::StringArray queries { "node 12", "label", "de 4", "no such component" };
+            results->setProperty ("filterTree",
+                measure (
+                    iterations, [&] { inspector.filterTree ({}); }, [&] { inspector.filterTree (queries[query++ % queries.size()]); }));
+
+            inspector.filterTree ({});
+        }
+
+        // the model alone, nothing listening
+        {
+            melatonin::ComponentModel model;
+            size_t next = 0;
+            results->setProperty ("selectComponent",
+                measure (iterations, nullptr, [&] { model.selectComponent (picked[next++ % picked.size()]); }));
+            model.deselectComponent();
+        }
+
+        // a selection with the preview listening, cold selections take a fresh snapshot
+        {
+            melatonin::ComponentModel model;
+            melatonin::Preview preview (model);
+            preview.maxPreviewImageBounds = { 0, 0, 320, 200 };
+
+            size_t next = 0;
+            results->setProperty ("previewSnapshot",
+                measure (iterations, [&] { preview.clearSnapshotCache(); }, [&] { model.selectComponent (picked[next++ % picked.size()]); }));
+
+            // reselecting a component that was just shown, served from the snapshot cache
+            results->setProperty ("previewSnapshotCached",
+                measure (
+                    iterations,
+                    [&] {
+                        model.selectComponent (picked[next % picked.size()]);
+                        model.deselectComponent();
+                    },
+                    [&] { model.selectComponent (picked[next++ % picked.size()]); }));
+
+            // the root paints the whole hierarchy
+            results->setProperty ("previewSnapshotRoot",
+                measure (
+                    iterations,
+                    [&] {
+                        model.deselectComponent();
+                        preview.clearSnapshotCache();
+                    },
+                    [&] { model.selectComponent (h.root.get()); }));
+            model.deselectComponent();
+        }
+
+        // a fully expanded tree
+        {
+            melatonin::TreeUpdateScheduler scheduler;
+            melatonin::ComponentTreeViewItem rootItem (h.root.get(), noop, noop, &scheduler);
+            openAll (rootItem);
+
+            // nothing changed, every item diffs its children
+            results->setProperty ("validateSubItemsUnchanged",
+                measure (iterations, nullptr, [&] { forEachItem (rootItem, [] (melatonin::ComponentTreeViewItem& item) { item.validateSubItems(); }); }));
+
+            // a burst of child changes across the hierarchy, applied in one flush
+            std::vector<std::unique_ptr<juce::Component>> added;
+            results->setProperty ("validateSubItemsAfterChildChanges",
+                measure (
+                    iterations,
+                    [&] {
+                        added.clear();
+                        scheduler.flush();
+                        for (auto* parent : picked)
+                        {
+                            added.push_back (std::make_unique<Node> (juce::Colours::red));
+                            parent->addAndMakeVisible (added.back().get());
+                        }
+                    },
+                    [&] { scheduler.flush(); }));
+
+            added.clear();
+            scheduler.flush();
+        }
+
+        auto hierarchy = std::make_unique<juce::DynamicObject>();
+        hierarchy->setProperty ("shape", shape.name);
+        hierarchy->setProperty ("nodes", (int) h.all.size());
+        hierarchy->setProperty ("fanOut", shape.fanOut);
+        hierarchy->setProperty ("depth", h.depth);
+        hierarchy->setProperty ("results", results.release());
+        return hierarchy.release();
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    // no window is ever shown, this just brings up the message manager and fonts
+    juce::ScopedJuceInitialiser_GUI gui;
+
+    // created once so the settings file isn't reloaded for every inspector component
+    juce::SharedResourcePointer<melatonin::InspectorSettings> settings;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    auto valueAfter = [&] (const juce::String& flag, const juce::String& fallback) {
+        auto index = args.indexOf (flag);
+        return index >= 0 && index + 1 < args.size() ? args[index + 1] : fallback;
+    };
+
+    auto sizes = juce::StringArray::fromTokens (valueAfter ("--sizes", "1000,10000,50000"), ",", {});
+    auto iterations = juce::jmax (1, valueAfter ("--iterations", "20").getIntValue());
+    auto output = valueAfter ("--output", {});
+
+    juce::Array<juce::var> runs;
+    for (auto& size : sizes)
+        for (auto& shape : shapes)
+        {
+            std::cerr << "benchmarking " << shape.name << " " << size << std::endl;
+            runs.add (runHierarchy (size.getIntValue(), shape, iterations));
+        }
+
+    auto report = std::make_unique<juce::DynamicObject>();
+    report->setProperty ("juceVersion", juce::SystemStats::getJUCEVersion());
+#if JUCE_DEBUG
+    report->setProperty ("build", "debug");
+#else
+    report->setProperty ("build", "release");
+#endif
+    report->setProperty ("iterations", iterations);
+    report->setProperty ("hierarchies", runs);
+
+    auto json = juce::JSON::toString (juce::var (report.release()));
+    if (output.isEmpty())
+        std::cout << json << std::endl;
+    else if (!juce::File::getCurrentWorkingDirectory().getChildFile (output).replaceWithText (json))
+        return 1;
+
+    return 0;
+}